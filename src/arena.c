@@ -0,0 +1,279 @@
+/** @file
+ * Implementacja alokatora pamięci, który posiada wszystkie bloki jednej bazy przekierowań
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define FIRST_SLAB_SIZE 4096 /**< rozmiar pierwszej płyty alokatora */
+#define MAX_SLAB_SIZE (1 << 20) /**< rozmiar, powyżej którego płyty przestają rosnąć */
+
+/** @brief Płyta, z której wycinane są małe bloki.
+ */
+struct ArenaSlab {
+
+    struct ArenaSlab *next; /**< wskaźnik na poprzednio przydzieloną płytę */
+    size_t size; /**< rozmiar obszaru na bloki */
+    char data[]; /**< obszar na bloki */
+};
+
+/** @brief Nagłówek dużego bloku przydzielanego osobno.
+ */
+struct ArenaLargeBlock {
+
+    struct ArenaLargeBlock *prev; /**< wskaźnik na poprzedni duży blok */
+    struct ArenaLargeBlock *next; /**< wskaźnik na następny duży blok */
+    char data[]; /**< obszar bloku */
+};
+
+/** @brief Zwolniony blok czekający, aż przestaną go czytać inne wątki.
+ */
+struct ArenaRetiredBlock {
+
+    void *ptr; /**< wskaźnik na zwolniony blok */
+    size_t size; /**< rozmiar bloku podany przy zwolnieniu */
+};
+
+/** @brief Porcja zapamiętanych zwolnionych bloków.
+ */
+struct ArenaRetiredChunk {
+
+    struct ArenaRetiredChunk *next; /**< wskaźnik na poprzednio zapełnianą porcję */
+    size_t count; /**< liczba bloków w porcji */
+    struct ArenaRetiredBlock blocks[ARENA_RETIRED_CHUNK]; /**< zwolnione bloki */
+};
+
+/** @brief Zaokrągla rozmiar do wielokrotności wyrównania.
+ * @param[in] size - rozmiar w bajtach.
+ * @return Zaokrąglony rozmiar, co najmniej @ref ARENA_ALIGNMENT.
+ */
+static size_t roundSize(size_t size) {
+
+    if (size == 0)
+        return ARENA_ALIGNMENT;
+
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+void arenaInit(struct Arena *arena) {
+
+    arena->slabs = NULL;
+    arena->cursor = NULL;
+    arena->remaining = 0;
+    arena->nextSlabSize = FIRST_SLAB_SIZE;
+    memset(arena->freeLists, 0, sizeof(arena->freeLists));
+    arena->largeBlocks = NULL;
+    arena->retired = NULL;
+    arena->sealed = NULL;
+    arena->retiredCount = 0;
+}
+
+/** @brief Przydziela nową płytę i ustawia ją jako najnowszą.
+ * Niewykorzystana końcówka poprzedniej płyty jest porzucana.
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in] size - najmniejszy wymagany rozmiar obszaru na bloki.
+ * @return Wartość @p true jeśli udało się przydzielić płytę,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool addSlab(struct Arena *arena, size_t size) {
+
+    size_t slabSize = arena->nextSlabSize;
+
+    if (slabSize < size)
+        slabSize = size;
+
+    struct ArenaSlab *slab = malloc(sizeof(struct ArenaSlab) + slabSize);
+
+    if (slab == NULL)
+        return false;
+
+    slab->next = arena->slabs;
+    slab->size = slabSize;
+    arena->slabs = slab;
+    arena->cursor = slab->data;
+    arena->remaining = slabSize;
+
+    if (arena->nextSlabSize < MAX_SLAB_SIZE)
+        arena->nextSlabSize *= 2;
+
+    return true;
+}
+
+void *arenaAlloc(struct Arena *arena, size_t size) {
+
+    size = roundSize(size);
+
+    if (size > ARENA_SMALL_LIMIT) {
+
+        struct ArenaLargeBlock *block = malloc(sizeof(struct ArenaLargeBlock) + size);
+
+        if (block == NULL)
+            return NULL;
+
+        block->prev = NULL;
+        block->next = arena->largeBlocks;
+
+        if (arena->largeBlocks != NULL)
+            arena->largeBlocks->prev = block;
+
+        arena->largeBlocks = block;
+
+        return block->data;
+    }
+
+    struct ArenaFreeBlock **freeList = &(arena->freeLists[size / ARENA_ALIGNMENT - 1]);
+
+    if ((*freeList) != NULL) {
+
+        struct ArenaFreeBlock *block = (*freeList);
+        (*freeList) = block->next;
+
+        return block;
+    }
+
+    if (arena->remaining < size && !addSlab(arena, size))
+        return NULL;
+
+    void *result = arena->cursor;
+    arena->cursor += size;
+    arena->remaining -= size;
+
+    return result;
+}
+
+/** @brief Oddaje blok do ponownego użycia.
+ * Mały blok trafia na listę wolnych bloków swojej klasy rozmiaru, a duży jest zwalniany.
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in,out] ptr - wskaźnik na blok;
+ * @param[in] size - rozmiar bloku w bajtach.
+ */
+static void recycleBlock(struct Arena *arena, void *ptr, size_t size) {
+
+    size = roundSize(size);
+
+    if (size > ARENA_SMALL_LIMIT) {
+
+        struct ArenaLargeBlock *block = (struct ArenaLargeBlock *) ((char *) ptr - offsetof(struct ArenaLargeBlock, data));
+
+        if (block->prev != NULL)
+            block->prev->next = block->next;
+
+        else
+            arena->largeBlocks = block->next;
+
+        if (block->next != NULL)
+            block->next->prev = block->prev;
+
+        free(block);
+        return;
+    }
+
+    struct ArenaFreeBlock *block = ptr;
+    struct ArenaFreeBlock **freeList = &(arena->freeLists[size / ARENA_ALIGNMENT - 1]);
+
+    block->next = (*freeList);
+    (*freeList) = block;
+}
+
+/** @brief Zwalnia porcje zwolnionych bloków, oddając najpierw same bloki do ponownego użycia.
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in,out] chunk - wskaźnik na pierwszą porcję listy.
+ */
+static void recycleChunks(struct Arena *arena, struct ArenaRetiredChunk *chunk) {
+
+    while (chunk != NULL) {
+
+        struct ArenaRetiredChunk *next = chunk->next;
+
+        for (size_t i = 0; i < chunk->count; i++)
+            recycleBlock(arena, chunk->blocks[i].ptr, chunk->blocks[i].size);
+
+        free(chunk);
+        chunk = next;
+    }
+}
+
+/** @brief Zwalnia porcje zwolnionych bloków bez oddawania bloków do ponownego użycia.
+ * @param[in,out] chunk - wskaźnik na pierwszą porcję listy.
+ */
+static void freeChunks(struct ArenaRetiredChunk *chunk) {
+
+    while (chunk != NULL) {
+
+        struct ArenaRetiredChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void arenaFree(struct Arena *arena, void *ptr, size_t size) {
+
+    if (ptr == NULL)
+        return;
+
+    struct ArenaRetiredChunk *chunk = arena->retired;
+
+    if (chunk == NULL || chunk->count == ARENA_RETIRED_CHUNK) {
+
+        chunk = malloc(sizeof(struct ArenaRetiredChunk));
+
+        /* Blok, którego nie udało się zapamiętać, zostaje w płycie lub na liście dużych
+         * bloków i zostanie zwolniony razem z całym alokatorem. */
+        if (chunk == NULL)
+            return;
+
+        chunk->next = arena->retired;
+        chunk->count = 0;
+        arena->retired = chunk;
+    }
+
+    chunk->blocks[chunk->count] = (struct ArenaRetiredBlock) {ptr, size};
+    chunk->count++;
+    arena->retiredCount++;
+}
+
+bool arenaSeal(struct Arena *arena) {
+
+    if (arena->sealed != NULL || arena->retired == NULL)
+        return false;
+
+    arena->sealed = arena->retired;
+    arena->retired = NULL;
+    arena->retiredCount = 0;
+
+    return true;
+}
+
+void arenaReclaim(struct Arena *arena) {
+
+    recycleChunks(arena, arena->sealed);
+    arena->sealed = NULL;
+}
+
+void arenaRelease(struct Arena *arena) {
+
+    freeChunks(arena->retired);
+    freeChunks(arena->sealed);
+
+    while (arena->slabs != NULL) {
+
+        struct ArenaSlab *tmp = arena->slabs;
+        arena->slabs = tmp->next;
+        free(tmp);
+    }
+
+    while (arena->largeBlocks != NULL) {
+
+        struct ArenaLargeBlock *tmp = arena->largeBlocks;
+        arena->largeBlocks = tmp->next;
+        free(tmp);
+    }
+
+    arenaInit(arena);
+}
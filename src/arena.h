@@ -0,0 +1,97 @@
+/** @file
+ * Interfejs alokatora pamięci, który posiada wszystkie bloki jednej bazy przekierowań
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT 8 /**< wyrównanie i ziarnistość rozmiarów przydzielanych bloków */
+#define ARENA_SMALL_LIMIT 256 /**< największy rozmiar bloku przydzielanego z płyt */
+#define ARENA_SIZE_CLASSES (ARENA_SMALL_LIMIT / ARENA_ALIGNMENT) /**< liczba klas rozmiarów małych bloków */
+#define ARENA_RETIRED_CHUNK 256 /**< liczba zwolnionych bloków zapamiętywanych w jednej porcji */
+
+/** @brief Zwolniony mały blok czekający na ponowne użycie.
+ */
+struct ArenaFreeBlock {
+
+    struct ArenaFreeBlock *next; /**< wskaźnik na następny wolny blok tej samej klasy rozmiaru */
+};
+
+/** @brief Alokator pamięci jednej bazy przekierowań.
+ * Małe bloki są wycinane kolejno z dużych płyt (ang. slab), więc leżą w pamięci obok siebie.
+ * Zwolnione małe bloki trafiają na listę wolnych bloków swojej klasy rozmiaru i są używane
+ * ponownie. Bloki większe niż @ref ARENA_SMALL_LIMIT są przydzielane osobno i łączone w listę.
+ * Zwolnienie całego alokatora zwalnia każdą płytę i każdy duży blok jednym wywołaniem @p free,
+ * bez przechodzenia po przydzielonych w nich obiektach.
+ * Zwolnione bloki nie wracają od razu do użycia, bo mogą je jeszcze czytać wątki, które
+ * przeglądają bazę współbieżnie z jej zmianami. Są zapamiętywane w bieżącej grupie;
+ * właściciel alokatora zamyka grupę (@ref arenaSeal), a gdy żaden czytelnik nie może już
+ * widzieć jej bloków, oddaje je do ponownego użycia (@ref arenaReclaim).
+ */
+struct Arena {
+
+    struct ArenaSlab *slabs; /**< wskaźnik na listę płyt, od najnowszej */
+    char *cursor; /**< wskaźnik na pierwszy nieprzydzielony bajt najnowszej płyty */
+    size_t remaining; /**< liczba nieprzydzielonych bajtów najnowszej płyty */
+    size_t nextSlabSize; /**< rozmiar następnej płyty */
+    struct ArenaFreeBlock *freeLists[ARENA_SIZE_CLASSES]; /**< listy wolnych bloków według klasy rozmiaru */
+    struct ArenaLargeBlock *largeBlocks; /**< wskaźnik na listę dużych bloków */
+    struct ArenaRetiredChunk *retired; /**< wskaźnik na porcje bloków zwolnionych od zamknięcia ostatniej grupy */
+    struct ArenaRetiredChunk *sealed; /**< wskaźnik na porcje bloków zamkniętej grupy lub NULL */
+    size_t retiredCount; /**< liczba bloków zwolnionych od zamknięcia ostatniej grupy */
+};
+
+/** @brief Inicjuje pusty alokator.
+ * @param[out] arena - wskaźnik na inicjowany alokator.
+ */
+void arenaInit(struct Arena *arena);
+
+/** @brief Przydziela blok pamięci.
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in] size - rozmiar bloku w bajtach.
+ * @return Wskaźnik na blok wyrównany do @ref ARENA_ALIGNMENT lub NULL,
+ *         gdy nie udało się zaalokować pamięci.
+ */
+void *arenaAlloc(struct Arena *arena, size_t size);
+
+/** @brief Zwalnia blok pamięci.
+ * Blok musi pochodzić z tego samego alokatora, a @p size musi być równy rozmiarowi
+ * podanemu przy jego przydzieleniu. Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * Zawartość bloku pozostaje nienaruszona, dopóki blok nie zostanie oddany do ponownego
+ * użycia przez @ref arenaReclaim. Jeśli nie uda się zapamiętać bloku, nie jest on
+ * używany ponownie aż do zwolnienia całego alokatora.
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in,out] ptr - wskaźnik na zwalniany blok;
+ * @param[in] size - rozmiar bloku w bajtach.
+ */
+void arenaFree(struct Arena *arena, void *ptr, size_t size);
+
+/** @brief Zamyka bieżącą grupę zwolnionych bloków.
+ * Nic nie robi, jeśli poprzednio zamknięta grupa nie została jeszcze oddana do ponownego
+ * użycia albo bieżąca grupa jest pusta.
+ * @param[in,out] arena - wskaźnik na alokator.
+ * @return Wartość @p true jeśli grupa została zamknięta, wartość @p false w przeciwnym razie.
+ */
+bool arenaSeal(struct Arena *arena);
+
+/** @brief Oddaje do ponownego użycia bloki zamkniętej grupy.
+ * Wywołujący odpowiada za to, że żaden wątek nie czyta już tych bloków.
+ * @param[in,out] arena - wskaźnik na alokator.
+ */
+void arenaReclaim(struct Arena *arena);
+
+/** @brief Zwalnia całą pamięć alokatora.
+ * Wszystkie przydzielone z niego bloki przestają być ważne. Po wywołaniu alokator
+ * jest pusty i może być używany dalej.
+ * @param[in,out] arena - wskaźnik na alokator.
+ */
+void arenaRelease(struct Arena *arena);
+
+#endif /* __ARENA_H__ */
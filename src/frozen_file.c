@@ -0,0 +1,188 @@
+/** @file
+ * Implementacja zapisu migawek baz przekierowań do plików i odwzorowywania ich w pamięć
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#define _POSIX_C_SOURCE 200809L /**< udostępnia funkcje POSIX przy kompilacji w trybie C11 */
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "frozen_file.h"
+
+#define FROZEN_DIGITS 12 /**< liczba znaków uznawanych za cyfry */
+
+bool phfwdFrozenWrite(struct FrozenForward const *ff, int fd) {
+
+    if (ff == NULL)
+        return false;
+
+    const char *data = (const char *) ff;
+    size_t remaining = ff->size;
+
+    while (remaining > 0) {
+
+        ssize_t written = write(fd, data, remaining);
+
+        if (written == 0 || (written < 0 && errno != EINTR))
+            return false;
+
+        if (written > 0) {
+            data += written;
+            remaining -= (size_t) written;
+        }
+    }
+
+    return true;
+}
+
+/** @brief Sprawdza, czy nagłówek opisuje migawkę zajmującą dokładnie podany obszar.
+ * @param[in] ff - wskaźnik na początek obszaru;
+ * @param[in] size - rozmiar obszaru w bajtach, co najmniej rozmiar nagłówka.
+ * @return Wartość @p true jeśli wersja i rozmiary części migawki są zgodne z nagłówkiem,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool frozenHeaderValid(const struct FrozenForward *ff, size_t size) {
+
+    if (ff->magic != FROZEN_MAGIC || ff->version != FROZEN_VERSION || ff->size != size)
+        return false;
+
+    if (ff->nodeCount == 0 || ff->nodesOffset != sizeof(struct FrozenForward))
+        return false;
+
+    if (ff->entriesOffset != ff->nodesOffset + (uint64_t) ff->nodeCount * sizeof(struct FrozenNode))
+        return false;
+
+    if (ff->stringsOffset != ff->entriesOffset + (uint64_t) ff->entryCount * sizeof(uint32_t))
+        return false;
+
+    return (ff->size == ff->stringsOffset + ff->stringsSize);
+}
+
+/** @brief Sprawdza, czy węzeł migawki odwołuje się tylko do jej wnętrza.
+ * Etykiety węzłów muszą leżeć w obszarze napisów kolejno, jedna za drugą, więc
+ * sprawdzenie wszystkich węzłów czyta każdy znak etykiety raz. Synowie węzła muszą
+ * zajmować w tablicy węzłów kolejne pozycje za synami poprzednich węzłów, wskazywać
+ * go jako ojca i mieć etykiety zaczynające się od swoich cyfr.
+ * @param[in] ff - wskaźnik na migawkę o poprawnym nagłówku;
+ * @param[in] index - indeks sprawdzanego węzła;
+ * @param[in,out] labelCursor - pozycja, od której musi zaczynać się etykieta węzła;
+ * @param[in,out] childCursor - indeks, od którego muszą zaczynać się synowie węzła.
+ * @return Wartość @p true jeśli węzeł jest poprawny,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool frozenNodeValid(const struct FrozenForward *ff, uint32_t index, uint64_t *labelCursor, uint64_t *childCursor) {
+
+    const struct FrozenNode *nodes = (const struct FrozenNode *) ((const char *) ff + ff->nodesOffset);
+    const uint32_t *entries = (const uint32_t *) ((const char *) ff + ff->entriesOffset);
+    const char *strings = (const char *) ff + ff->stringsOffset;
+    const struct FrozenNode *node = &(nodes[index]);
+
+    if (node->occupancy >= (1u << FROZEN_DIGITS) || (node->reverseMask & ~node->occupancy) != 0)
+        return false;
+
+    if (index == 0 ? node->parent != FROZEN_NONE : (node->parent >= index || node->labelLength == 0))
+        return false;
+
+    if (node->label != (*labelCursor) || (*labelCursor) + node->labelLength >= ff->stringsSize)
+        return false;
+
+    for (uint32_t i = 0; i < node->labelLength; i++) {
+
+        if (strings[node->label + i] < '0' || strings[node->label + i] >= '0' + FROZEN_DIGITS)
+            return false;
+    }
+
+    (*labelCursor) += node->labelLength;
+
+    if (node->fwdTo != FROZEN_NONE && node->fwdTo >= ff->stringsSize)
+        return false;
+
+    if (node->fwdFrom != FROZEN_NONE && (node->fwdFrom >= ff->entryCount || entries[node->fwdFrom] == FROZEN_NONE))
+        return false;
+
+    if (node->firstChild != (*childCursor))
+        return false;
+
+    for (int digit = 0; digit < FROZEN_DIGITS; digit++) {
+
+        if ((node->occupancy & (1u << digit)) != 0) {
+
+            uint64_t child = (*childCursor)++;
+
+            if (child >= ff->nodeCount || nodes[child].parent != index || nodes[child].label >= ff->stringsSize
+                || strings[nodes[child].label] != '0' + digit)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/** @brief Sprawdza, czy wszystkie odwołania wewnątrz migawki mieszczą się w jej bloku.
+ * Po pomyślnym sprawdzeniu zapytania o migawkę nie czytają spoza bloku i się kończą,
+ * nawet jeśli plik nie pochodzi z @ref phfwdFrozenWrite. Sprawdzenie czyta blok raz
+ * i nie alokuje pamięci.
+ * @param[in] ff - wskaźnik na migawkę o poprawnym nagłówku.
+ * @return Wartość @p true jeśli migawka jest poprawna,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool frozenContentValid(const struct FrozenForward *ff) {
+
+    const struct FrozenNode *nodes = (const struct FrozenNode *) ((const char *) ff + ff->nodesOffset);
+    const uint32_t *entries = (const uint32_t *) ((const char *) ff + ff->entriesOffset);
+    const char *strings = (const char *) ff + ff->stringsOffset;
+    uint64_t labelCursor = nodes[0].label;
+    uint64_t childCursor = 1;
+
+    if (ff->stringsSize == 0 || strings[ff->stringsSize - 1] != '\0')
+        return false;
+
+    if (ff->entryCount > 0 && entries[ff->entryCount - 1] != FROZEN_NONE)
+        return false;
+
+    for (uint32_t i = 0; i < ff->entryCount; i++) {
+
+        if (entries[i] != FROZEN_NONE && entries[i] >= ff->stringsSize)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < ff->nodeCount; i++) {
+
+        if (!frozenNodeValid(ff, i, &labelCursor, &childCursor))
+            return false;
+    }
+
+    return true;
+}
+
+struct FrozenForward const * phfwdFrozenMap(int fd) {
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(struct FrozenForward))
+        return NULL;
+
+    size_t size = (size_t) info.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    if (!frozenHeaderValid(data, size) || !frozenContentValid(data)) {
+        munmap(data, size);
+        return NULL;
+    }
+
+    return data;
+}
+
+void phfwdFrozenUnmap(struct FrozenForward const *ff) {
+
+    if (ff != NULL)
+        munmap((void *) ff, ff->size);
+}
@@ -0,0 +1,44 @@
+/** @file
+ * Interfejs zapisu migawek baz przekierowań do plików i odwzorowywania ich w pamięć
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#ifndef __FROZEN_FILE_H__
+#define __FROZEN_FILE_H__
+
+#include <stdbool.h>
+#include "phone_forward.h"
+
+/** @brief Zapisuje migawkę do pliku.
+ * Plik zawiera dokładnie blok migawki, w kolejności bajtów maszyny, na której go zapisano.
+ * @param[in] ff – wskaźnik na migawkę;
+ * @param[in] fd – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true jeśli cały blok został zapisany,
+ *         wartość @p false, jeśli @p ff ma wartość NULL lub zapis się nie powiódł.
+ */
+bool phfwdFrozenWrite(struct FrozenForward const *ff, int fd);
+
+/** @brief Odwzorowuje w pamięć migawkę zapisaną w pliku.
+ * Plik jest odwzorowywany tylko do odczytu i współdzielony, więc wiele procesów
+ * korzysta z jednej kopii stron w pamięci podręcznej systemu. Migawka nie jest
+ * kopiowana ani przekształcana: jest tylko raz przeglądana w celu sprawdzenia, że
+ * wszystkie indeksy i pozycje mieszczą się w pliku, a zapytania @ref phfwdFrozenGet,
+ * @ref phfwdFrozenReverse i @ref phfwdFrozenNonTrivialCount czytają bezpośrednio z pliku.
+ * Deskryptor może zostać zamknięty zaraz po wywołaniu.
+ * @param[in] fd – deskryptor pliku otwartego do odczytu.
+ * @return Wskaźnik na migawkę, którą należy zwolnić za pomocą funkcji
+ *         @ref phfwdFrozenUnmap, lub NULL, jeśli nie udało się odwzorować pliku
+ *         albo jego zawartość nie jest poprawną migawką w obsługiwanej wersji.
+ */
+struct FrozenForward const * phfwdFrozenMap(int fd);
+
+/** @brief Usuwa odwzorowanie migawki w pamięć.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] ff – wskaźnik na migawkę uzyskaną z @ref phfwdFrozenMap.
+ */
+void phfwdFrozenUnmap(struct FrozenForward const *ff);
+
+#endif /* __FROZEN_FILE_H__ */
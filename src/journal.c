@@ -0,0 +1,554 @@
+/** @file
+ * Implementacja dziennika zmian bazy przekierowań, który pozwala odtworzyć bazę po awarii
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#define _POSIX_C_SOURCE 200809L /**< udostępnia funkcje POSIX przy kompilacji w trybie C11 */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "journal.h"
+
+#define JOURNAL_RECORD_ADD 1 /**< rodzaj zapisu dziennika: dodanie przekierowania */
+#define JOURNAL_RECORD_REMOVE 2 /**< rodzaj zapisu dziennika: usunięcie przekierowań */
+#define JOURNAL_SUFFIX ".journal" /**< rozszerzenie pliku dziennika */
+#define SNAPSHOT_SUFFIX ".snapshot" /**< rozszerzenie pliku ze zrzutem bazy */
+#define TEMPORARY_SUFFIX ".tmp" /**< rozszerzenie pliku, do którego zapisywany jest nowy zrzut */
+#define CHECKSUM_SIZE 4 /**< liczba bajtów sumy kontrolnej zapisu */
+#define REPLAY_APPLIED 0 /**< zapis dziennika został nałożony na bazę */
+#define REPLAY_END 1 /**< dziennik się skończył lub dalsza jego część jest niedokończona */
+#define REPLAY_FAILED 2 /**< nie udało się nałożyć zapisu na bazę */
+#define FNV32_OFFSET_BASIS 2166136261u /**< wartość początkowa sumy kontrolnej FNV-1a */
+#define FNV32_PRIME 16777619u /**< mnożnik sumy kontrolnej FNV-1a */
+
+/** @brief Uwzględnia bajty w sumie kontrolnej.
+ * @param[in] checksum - dotychczasowa suma kontrolna;
+ * @param[in] data - wskaźnik na bajty;
+ * @param[in] size - liczba bajtów.
+ * @return Suma kontrolna FNV-1a uwzględniająca nowe bajty.
+ */
+static uint32_t checksumUpdate(uint32_t checksum, const unsigned char *data, size_t size) {
+
+    for (size_t i = 0; i < size; i++) {
+        checksum ^= data[i];
+        checksum *= FNV32_PRIME;
+    }
+
+    return checksum;
+}
+
+/** @brief Zapisuje do pliku zawartość bufora dziennika, bez utrwalania.
+ * @param[in,out] journal - wskaźnik na dziennik.
+ * @return Wartość @p true jeśli się udało, wartość @p false w przeciwnym razie.
+ */
+static bool journalFlush(struct Journal *journal) {
+
+    size_t done = 0;
+
+    while (done < journal->used) {
+
+        ssize_t written = write(journal->fd, journal->buffer + done, journal->used - done);
+
+        if (written == 0 || (written < 0 && errno != EINTR))
+            return false;
+
+        if (written > 0)
+            done += (size_t) written;
+    }
+
+    journal->used = 0;
+
+    return true;
+}
+
+/** @brief Dopisuje bajty zapisu do bufora dziennika.
+ * @param[in,out] journal - wskaźnik na dziennik;
+ * @param[in] data - wskaźnik na bajty;
+ * @param[in] size - liczba bajtów;
+ * @param[in,out] checksum - wskaźnik na sumę kontrolną zapisu.
+ * @return Wartość @p true jeśli się udało, wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+static bool journalPut(struct Journal *journal, const unsigned char *data, size_t size, uint32_t *checksum) {
+
+    (*checksum) = checksumUpdate((*checksum), data, size);
+    journal->size += size;
+
+    while (size > 0) {
+
+        if (journal->used == JOURNAL_BUFFER_SIZE && !journalFlush(journal))
+            return false;
+
+        size_t chunk = JOURNAL_BUFFER_SIZE - journal->used;
+
+        if (chunk > size)
+            chunk = size;
+
+        memcpy(journal->buffer + journal->used, data, chunk);
+        journal->used += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+/** @brief Dopisuje do zapisu długość numeru w kodowaniu o zmiennej długości.
+ * @param[in,out] journal - wskaźnik na dziennik;
+ * @param[in] value - długość;
+ * @param[in,out] checksum - wskaźnik na sumę kontrolną zapisu.
+ * @return Wartość @p true jeśli się udało, wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+static bool journalPutLength(struct Journal *journal, uint64_t value, uint32_t *checksum) {
+
+    unsigned char bytes[10];
+    size_t size = 0;
+
+    do {
+        bytes[size] = (unsigned char) (value & 0x7f);
+        value >>= 7;
+
+        if (value != 0)
+            bytes[size] |= 0x80;
+
+        size++;
+    } while (value != 0);
+
+    return journalPut(journal, bytes, size, checksum);
+}
+
+/** @brief Dopisuje do zapisu cyfry numeru upakowane po dwie w bajcie.
+ * @param[in,out] journal - wskaźnik na dziennik;
+ * @param[in] num - wskaźnik na napis reprezentujący numer;
+ * @param[in] length - długość numeru;
+ * @param[in,out] checksum - wskaźnik na sumę kontrolną zapisu.
+ * @return Wartość @p true jeśli się udało, wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+static bool journalPutDigits(struct Journal *journal, const char *num, size_t length, uint32_t *checksum) {
+
+    for (size_t i = 0; i < length; i += 2) {
+
+        unsigned char byte = (unsigned char) ((num[i] - '0') << 4);
+
+        if (i + 1 < length)
+            byte |= (unsigned char) (num[i + 1] - '0');
+
+        if (!journalPut(journal, &byte, 1, checksum))
+            return false;
+    }
+
+    return true;
+}
+
+bool journalCommit(struct Journal *journal) {
+
+    if (!journalFlush(journal) || fdatasync(journal->fd) != 0)
+        return false;
+
+    journal->pending = 0;
+
+    return true;
+}
+
+/** @brief Utrwala wpisy katalogu, w którym leży plik.
+ * Dopiero po utrwaleniu katalogu zmiana nazwy pliku przetrwa awarię.
+ * @param[in] path - ścieżka do pliku.
+ * @return Wartość @p true jeśli się udało, wartość @p false w przeciwnym razie.
+ */
+static bool directorySync(const char *path) {
+
+    const char *slash = strrchr(path, '/');
+    size_t length = (slash == NULL ? 0 : (slash == path ? 1 : (size_t) (slash - path)));
+    char *directory = malloc(length + sizeof("."));
+
+    if (directory == NULL)
+        return false;
+
+    if (slash == NULL)
+        memcpy(directory, ".", sizeof("."));
+
+    else {
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    bool synced = (fd >= 0 && fsync(fd) == 0);
+
+    if (fd >= 0 && close(fd) != 0)
+        synced = false;
+
+    free(directory);
+
+    return synced;
+}
+
+/** @brief Zapisuje zrzut bazy i opróżnia dziennik.
+ * Zrzut jest zapisywany do pliku tymczasowego, utrwalany i dopiero wtedy zastępuje
+ * poprzedni zrzut. Dziennik jest opróżniany dopiero po utrwaleniu katalogu zrzutu,
+ * bo wcześniej po awarii mógłby wrócić poprzedni zrzut bez zmian z dziennika. Jeśli
+ * awaria nastąpi po zastąpieniu zrzutu, ale przed opróżnieniem dziennika, odtwarzanie
+ * nałoży na nowy zrzut zmiany, które już zawiera. Jest to bezpieczne, bo wynik zmian
+ * nałożonych na stan, który już je uwzględnia, się nie zmienia: o każdym przekierowaniu
+ * decyduje ostatnia zmiana, która go dotyczy.
+ * @param[in,out] journal - wskaźnik na dziennik;
+ * @param[in] pf - wskaźnik na bazę.
+ * @return Wartość @p true jeśli się udało, wartość @p false w przeciwnym razie.
+ */
+static bool journalCheckpoint(struct Journal *journal, struct PhoneForward *pf) {
+
+    if (!journalCommit(journal))
+        return false;
+
+    size_t length = strlen(journal->snapshotPath);
+    char *temporaryPath = malloc(length + sizeof(TEMPORARY_SUFFIX));
+
+    if (temporaryPath == NULL)
+        return false;
+
+    memcpy(temporaryPath, journal->snapshotPath, length);
+    memcpy(temporaryPath + length, TEMPORARY_SUFFIX, sizeof(TEMPORARY_SUFFIX));
+
+    int fd = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool saved = (fd >= 0 && phfwdSave(pf, fd) && fsync(fd) == 0);
+
+    if (fd >= 0 && close(fd) != 0)
+        saved = false;
+
+    if (saved)
+        saved = (rename(temporaryPath, journal->snapshotPath) == 0 && directorySync(journal->snapshotPath));
+
+    free(temporaryPath);
+
+    if (!saved || ftruncate(journal->fd, 0) != 0)
+        return false;
+
+    journal->size = 0;
+
+    return true;
+}
+
+/** @brief Kończy zapis sumą kontrolną i w razie potrzeby utrwala grupę zapisów lub zapisuje zrzut bazy.
+ * @param[in,out] journal - wskaźnik na dziennik;
+ * @param[in] pf - wskaźnik na bazę po zmianie;
+ * @param[in] checksum - suma kontrolna zapisu.
+ * @return Wartość @p true jeśli się udało, wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+static bool journalFinishRecord(struct Journal *journal, struct PhoneForward *pf, uint32_t checksum) {
+
+    unsigned char bytes[CHECKSUM_SIZE];
+    uint32_t unused = 0;
+
+    for (int i = 0; i < CHECKSUM_SIZE; i++)
+        bytes[i] = (unsigned char) (checksum >> (8 * i));
+
+    if (!journalPut(journal, bytes, CHECKSUM_SIZE, &unused))
+        return false;
+
+    journal->pending++;
+
+    if (journal->size >= JOURNAL_CHECKPOINT_SIZE)
+        return journalCheckpoint(journal, pf);
+
+    if (journal->pending >= JOURNAL_GROUP_SIZE)
+        return journalCommit(journal);
+
+    return true;
+}
+
+bool journalAdd(struct Journal *journal, struct PhoneForward *pf, const char *num1, const char *num2) {
+
+    unsigned char type = JOURNAL_RECORD_ADD;
+    uint32_t checksum = FNV32_OFFSET_BASIS;
+    size_t length1 = strlen(num1);
+    size_t length2 = strlen(num2);
+
+    return (journalPut(journal, &type, 1, &checksum)
+            && journalPutLength(journal, length1, &checksum) && journalPutLength(journal, length2, &checksum)
+            && journalPutDigits(journal, num1, length1, &checksum) && journalPutDigits(journal, num2, length2, &checksum)
+            && journalFinishRecord(journal, pf, checksum));
+}
+
+bool journalRemove(struct Journal *journal, struct PhoneForward *pf, const char *num) {
+
+    unsigned char type = JOURNAL_RECORD_REMOVE;
+    uint32_t checksum = FNV32_OFFSET_BASIS;
+    size_t length = strlen(num);
+
+    return (journalPut(journal, &type, 1, &checksum) && journalPutLength(journal, length, &checksum)
+            && journalPutDigits(journal, num, length, &checksum) && journalFinishRecord(journal, pf, checksum));
+}
+
+/** @brief Odczytuje z zapisu długość numeru.
+ * @param[in] data - wskaźnik na zawartość dziennika;
+ * @param[in] size - rozmiar zawartości;
+ * @param[in,out] position - wskaźnik na pozycję odczytu;
+ * @param[out] value - wskaźnik na miejsce na odczytaną długość.
+ * @return Wartość @p true jeśli udało się odczytać długość, wartość @p false w przeciwnym razie.
+ */
+static bool readLength(const unsigned char *data, size_t size, size_t *position, uint64_t *value) {
+
+    unsigned shift = 0;
+    unsigned char byte;
+
+    (*value) = 0;
+
+    do {
+        if ((*position) == size || shift > 63)
+            return false;
+
+        byte = data[(*position)++];
+        (*value) |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return true;
+}
+
+/** @brief Odczytuje z zapisu cyfry numeru.
+ * @param[in] data - wskaźnik na zawartość dziennika;
+ * @param[in] size - rozmiar zawartości;
+ * @param[in,out] position - wskaźnik na pozycję odczytu;
+ * @param[in] length - długość numeru.
+ * @return Wskaźnik na napis numeru, który należy zwolnić, lub NULL, jeśli zapis jest
+ *         niepełny, niepoprawny lub nie udało się zaalokować pamięci.
+ */
+static char *readDigits(const unsigned char *data, size_t size, size_t *position, uint64_t length) {
+
+    if (length == 0 || length > 2 * (uint64_t) (size - (*position)))
+        return NULL;
+
+    char *num = malloc(length + 1);
+
+    if (num == NULL)
+        return NULL;
+
+    for (uint64_t i = 0; i < length; i++) {
+
+        unsigned char byte = data[(*position) + i / 2];
+        int digit = (i % 2 == 0 ? byte >> 4 : byte & 0x0f);
+
+        if (digit > ';' - '0') {
+            free(num);
+            return NULL;
+        }
+
+        num[i] = (char) ('0' + digit);
+    }
+
+    num[length] = '\0';
+    (*position) += (length + 1) / 2;
+
+    return num;
+}
+
+/** @brief Nakłada na bazę jeden zapis dziennika.
+ * @param[in] data - wskaźnik na zawartość dziennika;
+ * @param[in] size - rozmiar zawartości;
+ * @param[in,out] position - wskaźnik na początek zapisu, przesuwany za zapis;
+ * @param[in,out] pf - wskaźnik na bazę.
+ * @return @ref REPLAY_APPLIED, jeśli zapis był kompletny i poprawny i został nałożony,
+ *         @ref REPLAY_END, jeśli zapisu nie ma lub jest niekompletny albo uszkodzony,
+ *         @ref REPLAY_FAILED, jeśli nie udało się zaalokować pamięci.
+ */
+static int replayRecord(const unsigned char *data, size_t size, size_t *position, struct PhoneForward *pf) {
+
+    size_t start = (*position);
+    uint64_t length1, length2 = 0;
+
+    if (start == size)
+        return REPLAY_END;
+
+    unsigned char type = data[(*position)++];
+
+    if ((type != JOURNAL_RECORD_ADD && type != JOURNAL_RECORD_REMOVE) || !readLength(data, size, position, &length1)
+        || (type == JOURNAL_RECORD_ADD && !readLength(data, size, position, &length2)))
+        return REPLAY_END;
+
+    char *num1 = readDigits(data, size, position, length1);
+    char *num2 = (type == JOURNAL_RECORD_ADD && num1 != NULL ? readDigits(data, size, position, length2) : NULL);
+    bool valid = (num1 != NULL && (type == JOURNAL_RECORD_REMOVE || num2 != NULL) && size - (*position) >= CHECKSUM_SIZE);
+
+    if (valid) {
+
+        uint32_t checksum = checksumUpdate(FNV32_OFFSET_BASIS, data + start, (*position) - start);
+
+        for (int i = 0; i < CHECKSUM_SIZE; i++)
+            valid = valid && data[(*position) + i] == (unsigned char) (checksum >> (8 * i));
+
+        (*position) += CHECKSUM_SIZE;
+    }
+
+    int result = (valid ? REPLAY_APPLIED : REPLAY_END);
+
+    /* Zapisane przekierowanie zostało już raz poprawnie dodane, więc ponowne dodanie
+     * może się nie udać tylko z braku pamięci. */
+    if (valid && type == JOURNAL_RECORD_ADD && !phfwdAdd(pf, num1, num2))
+        result = REPLAY_FAILED;
+
+    else if (valid && type == JOURNAL_RECORD_REMOVE)
+        phfwdRemove(pf, num1);
+
+    free(num1);
+    free(num2);
+
+    return result;
+}
+
+/** @brief Nakłada na bazę zmiany z dziennika i odcina niedokończony zapis na jego końcu.
+ * @param[in] fd - deskryptor otwartego pliku dziennika;
+ * @param[in,out] pf - wskaźnik na bazę;
+ * @param[out] size - wskaźnik na miejsce na rozmiar poprawnej części dziennika.
+ * @return Wartość @p true jeśli się udało, wartość @p false w przeciwnym razie.
+ */
+static bool replayJournal(int fd, struct PhoneForward *pf, uint64_t *size) {
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0)
+        return false;
+
+    size_t fileSize = (size_t) info.st_size;
+    unsigned char *data = malloc(fileSize + 1);
+    size_t done = 0;
+
+    if (data == NULL)
+        return false;
+
+    while (done < fileSize) {
+
+        ssize_t got = pread(fd, data + done, fileSize - done, (off_t) done);
+
+        if (got == 0 || (got < 0 && errno != EINTR)) {
+            free(data);
+            return false;
+        }
+
+        if (got > 0)
+            done += (size_t) got;
+    }
+
+    size_t position = 0;
+    size_t valid = 0;
+    int result;
+
+    while ((result = replayRecord(data, fileSize, &position, pf)) == REPLAY_APPLIED)
+        valid = position;
+
+    free(data);
+    (*size) = valid;
+
+    if (result == REPLAY_FAILED)
+        return false;
+
+    return (valid == fileSize || ftruncate(fd, (off_t) valid) == 0);
+}
+
+/** @brief Tworzy ścieżkę pliku bazy.
+ * @param[in] directory - wskaźnik na ścieżkę katalogu;
+ * @param[in] id - wskaźnik na identyfikator bazy;
+ * @param[in] suffix - wskaźnik na rozszerzenie pliku.
+ * @return Wskaźnik na ścieżkę, którą należy zwolnić, lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static char *basePath(const char *directory, const char *id, const char *suffix) {
+
+    size_t length = strlen(directory) + strlen(id) + strlen(suffix) + 2;
+    char *path = malloc(length);
+
+    if (path != NULL)
+        snprintf(path, length, "%s/%s%s", directory, id, suffix);
+
+    return path;
+}
+
+/** @brief Odtwarza bazę ze zrzutu, jeśli istnieje.
+ * @param[in] snapshotPath - wskaźnik na ścieżkę pliku ze zrzutem.
+ * @return Wskaźnik na wczytaną bazę, pustą bazę, jeśli zrzutu nie ma, lub NULL
+ *         w razie błędu.
+ */
+static struct PhoneForward *loadSnapshot(const char *snapshotPath) {
+
+    int fd = open(snapshotPath, O_RDONLY);
+
+    if (fd < 0)
+        return (errno == ENOENT ? phfwdNew() : NULL);
+
+    struct PhoneForward *pf = phfwdLoad(fd);
+
+    close(fd);
+
+    return pf;
+}
+
+struct Journal * journalOpen(const char *directory, const char *id, struct PhoneForward **pf) {
+
+    struct Journal *journal = malloc(sizeof(struct Journal));
+
+    (*pf) = NULL;
+
+    if (journal == NULL)
+        return NULL;
+
+    journal->path = basePath(directory, id, JOURNAL_SUFFIX);
+    journal->snapshotPath = basePath(directory, id, SNAPSHOT_SUFFIX);
+    journal->fd = -1;
+    journal->pending = 0;
+    journal->used = 0;
+
+    if (journal->path != NULL && journal->snapshotPath != NULL) {
+
+        (*pf) = loadSnapshot(journal->snapshotPath);
+        journal->fd = ((*pf) == NULL ? -1 : open(journal->path, O_RDWR | O_CREAT | O_APPEND, 0644));
+    }
+
+    if (journal->fd >= 0 && replayJournal(journal->fd, (*pf), &(journal->size)))
+        return journal;
+
+    if (journal->fd >= 0)
+        close(journal->fd);
+
+    phfwdDelete((*pf));
+    (*pf) = NULL;
+    free(journal->path);
+    free(journal->snapshotPath);
+    free(journal);
+
+    return NULL;
+}
+
+bool journalClose(struct Journal *journal) {
+
+    if (journal == NULL)
+        return true;
+
+    bool committed = journalCommit(journal);
+
+    if (close(journal->fd) != 0)
+        committed = false;
+
+    free(journal->path);
+    free(journal->snapshotPath);
+    free(journal);
+
+    return committed;
+}
+
+void journalDiscard(struct Journal *journal) {
+
+    if (journal == NULL)
+        return;
+
+    close(journal->fd);
+    unlink(journal->path);
+    unlink(journal->snapshotPath);
+    free(journal->path);
+    free(journal->snapshotPath);
+    free(journal);
+}
@@ -0,0 +1,95 @@
+/** @file
+ * Interfejs dziennika zmian bazy przekierowań, który pozwala odtworzyć bazę po awarii
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "phone_forward.h"
+
+#define JOURNAL_BUFFER_SIZE 65536 /**< rozmiar bufora zapisów dziennika */
+#define JOURNAL_GROUP_SIZE 1024 /**< liczba zapisów, po której dziennik jest utrwalany na dysku */
+#define JOURNAL_CHECKPOINT_SIZE (64u << 20) /**< rozmiar dziennika, po którego przekroczeniu baza jest zapisywana w całości */
+
+/** @brief Dziennik zmian jednej bazy przekierowań.
+ * Obok dziennika leży ostatni pełny zapis bazy (zrzut) utworzony przez @ref phfwdSave.
+ * Stan bazy to zrzut z nałożonymi kolejno zmianami z dziennika. Zmiany są dopisywane
+ * do bufora i zapisywane do pliku grupami: wywołanie @p fdatasync przypada na
+ * @ref JOURNAL_GROUP_SIZE zmian, a nie na każdą z nich, więc po awarii może zginąć
+ * co najwyżej ostatnia, nieutrwalona grupa.
+ * Każdy zapis dziennika to rodzaj zmiany, długości numerów, cyfry numerów upakowane
+ * po dwie w bajcie i suma kontrolna, po której rozpoznawany jest niedokończony zapis
+ * na końcu pliku.
+ */
+struct Journal {
+
+    int fd; /**< deskryptor pliku dziennika */
+    char *path; /**< ścieżka pliku dziennika */
+    char *snapshotPath; /**< ścieżka pliku ze zrzutem bazy */
+    uint64_t size; /**< rozmiar dziennika razem z zawartością bufora */
+    size_t pending; /**< liczba zmian od ostatniego utrwalenia */
+    size_t used; /**< liczba bajtów w buforze */
+    unsigned char buffer[JOURNAL_BUFFER_SIZE]; /**< bufor zapisów */
+};
+
+/** @brief Otwiera dziennik bazy i odtwarza z niego bazę.
+ * Pliki bazy o identyfikatorze @p id to @p id.snapshot ze zrzutem i @p id.journal
+ * z dziennikiem w katalogu @p directory. Baza jest wczytywana ze zrzutu (lub tworzona
+ * pusta, jeśli zrzutu nie ma), a następnie są na nią nakładane zmiany z dziennika.
+ * Niedokończony zapis na końcu dziennika jest odcinany.
+ * @param[in] directory – wskaźnik na ścieżkę katalogu z plikami baz;
+ * @param[in] id – wskaźnik na identyfikator bazy, złożony z liter i cyfr;
+ * @param[out] pf – adres, pod który zostanie zapisany wskaźnik na odtworzoną bazę.
+ * @return Wskaźnik na dziennik lub NULL, jeśli nie udało się odtworzyć bazy,
+ *         otworzyć pliku lub zaalokować pamięci.
+ */
+struct Journal * journalOpen(const char *directory, const char *id, struct PhoneForward **pf);
+
+/** @brief Dopisuje do dziennika dodanie przekierowania.
+ * Po przekroczeniu rozmiaru @ref JOURNAL_CHECKPOINT_SIZE zapisuje zrzut bazy i opróżnia dziennik.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] pf – wskaźnik na bazę, w której przekierowanie zostało już dodane;
+ * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów przekierowywanych;
+ * @param[in] num2 – wskaźnik na napis reprezentujący prefiks docelowy.
+ * @return Wartość @p true jeśli udało się dopisać zmianę,
+ *         wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+bool journalAdd(struct Journal *journal, struct PhoneForward *pf, const char *num1, const char *num2);
+
+/** @brief Dopisuje do dziennika usunięcie przekierowań.
+ * Po przekroczeniu rozmiaru @ref JOURNAL_CHECKPOINT_SIZE zapisuje zrzut bazy i opróżnia dziennik.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] pf – wskaźnik na bazę, z której przekierowania zostały już usunięte;
+ * @param[in] num – wskaźnik na napis reprezentujący prefiks usuwanych przekierowań.
+ * @return Wartość @p true jeśli udało się dopisać zmianę,
+ *         wartość @p false, jeśli zapis do pliku się nie powiódł.
+ */
+bool journalRemove(struct Journal *journal, struct PhoneForward *pf, const char *num);
+
+/** @brief Zapisuje do pliku i utrwala na dysku wszystkie dopisane zmiany.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ * @return Wartość @p true jeśli się udało, wartość @p false w przeciwnym razie.
+ */
+bool journalCommit(struct Journal *journal);
+
+/** @brief Utrwala dziennik, zamyka go i zwalnia jego pamięć.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ * @return Wartość @p true jeśli zmiany zostały utrwalone, wartość @p false w przeciwnym razie.
+ */
+bool journalClose(struct Journal *journal);
+
+/** @brief Zamyka dziennik usuwanej bazy i usuwa jej pliki.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ */
+void journalDiscard(struct Journal *journal);
+
+#endif /* __JOURNAL_H__ */
@@ -0,0 +1,184 @@
+/** @file
+ * Implementacja puli numerów, w której każdy numer bazy przekierowań jest przechowywany raz
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#include <string.h>
+#include "number_pool.h"
+
+#define INITIAL_BUCKET_COUNT 16 /**< początkowa liczba kubełków puli */
+#define FNV_OFFSET_BASIS 14695981039346656037ULL /**< wartość początkowa skrótu FNV-1a */
+#define FNV_PRIME 1099511628211ULL /**< mnożnik skrótu FNV-1a */
+
+/** @brief Wyznacza nagłówek numeru z puli na podstawie wskaźnika na jego napis.
+ * @param[in] number - wskaźnik na napis numeru w puli.
+ * @return Wskaźnik na nagłówek numeru.
+ */
+static struct PooledNumber *pooledNumberOf(const char *number) {
+
+    return (struct PooledNumber *) (number - offsetof(struct PooledNumber, digits));
+}
+
+/** @brief Liczy skrót numeru.
+ * @param[in] num - wskaźnik na napis numeru;
+ * @param[in] length - długość numeru.
+ * @return Skrót FNV-1a numeru.
+ */
+static uint64_t hashNumber(const char *num, size_t length) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) num[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+bool numberPoolInit(struct NumberPool *pool, struct Arena *arena) {
+
+    pool->arena = arena;
+    pool->bucketCount = INITIAL_BUCKET_COUNT;
+    pool->count = 0;
+    pool->buckets = arenaAlloc(arena, pool->bucketCount * sizeof(struct PooledNumber *));
+
+    if (pool->buckets == NULL)
+        return false;
+
+    memset(pool->buckets, 0, pool->bucketCount * sizeof(struct PooledNumber *));
+
+    return true;
+}
+
+/** @brief Podwaja liczbę kubełków puli.
+ * Jeśli nie udało się zaalokować pamięci, pula pozostaje bez zmian.
+ * @param[in,out] pool - wskaźnik na pulę.
+ */
+static void growPool(struct NumberPool *pool) {
+
+    size_t bucketCount = pool->bucketCount * 2;
+    struct PooledNumber **buckets = arenaAlloc(pool->arena, bucketCount * sizeof(struct PooledNumber *));
+
+    if (buckets == NULL)
+        return;
+
+    memset(buckets, 0, bucketCount * sizeof(struct PooledNumber *));
+
+    for (size_t i = 0; i < pool->bucketCount; i++) {
+
+        struct PooledNumber *entry = pool->buckets[i];
+
+        while (entry != NULL) {
+
+            struct PooledNumber *next = entry->next;
+            size_t index = entry->hash & (bucketCount - 1);
+
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    arenaFree(pool->arena, pool->buckets, pool->bucketCount * sizeof(struct PooledNumber *));
+    pool->buckets = buckets;
+    pool->bucketCount = bucketCount;
+}
+
+/** @brief Wyszukuje numer w kubełku.
+ * @param[in] pool - wskaźnik na pulę;
+ * @param[in] num - wskaźnik na napis numeru;
+ * @param[in] length - długość numeru;
+ * @param[in] hash - skrót numeru.
+ * @return Wskaźnik na nagłówek numeru lub NULL, jeśli numeru nie ma w puli.
+ */
+static struct PooledNumber *findEntry(const struct NumberPool *pool, const char *num, size_t length, uint64_t hash) {
+
+    struct PooledNumber *entry = pool->buckets[hash & (pool->bucketCount - 1)];
+
+    while (entry != NULL) {
+
+        if (entry->hash == hash && entry->length == length && memcmp(entry->digits, num, length) == 0)
+            return entry;
+
+        entry = entry->next;
+    }
+
+    return NULL;
+}
+
+const char *numberPoolAcquire(struct NumberPool *pool, const char *num, size_t length) {
+
+    uint64_t hash = hashNumber(num, length);
+    struct PooledNumber *entry = findEntry(pool, num, length, hash);
+
+    if (entry != NULL) {
+        entry->references++;
+        return entry->digits;
+    }
+
+    entry = arenaAlloc(pool->arena, sizeof(struct PooledNumber) + length + 1);
+
+    if (entry == NULL)
+        return NULL;
+
+    entry->hash = hash;
+    entry->length = length;
+    entry->references = 1;
+    memcpy(entry->digits, num, length);
+    entry->digits[length] = '\0';
+
+    if (pool->count >= pool->bucketCount)
+        growPool(pool);
+
+    size_t index = hash & (pool->bucketCount - 1);
+
+    entry->next = pool->buckets[index];
+    pool->buckets[index] = entry;
+    pool->count++;
+
+    return entry->digits;
+}
+
+const char *numberPoolFind(const struct NumberPool *pool, const char *num, size_t length) {
+
+    struct PooledNumber *entry = findEntry(pool, num, length, hashNumber(num, length));
+
+    return (entry == NULL ? NULL : entry->digits);
+}
+
+void numberPoolRetain(const char *number) {
+
+    pooledNumberOf(number)->references++;
+}
+
+void numberPoolRelease(struct NumberPool *pool, const char *number) {
+
+    if (number == NULL)
+        return;
+
+    struct PooledNumber *entry = pooledNumberOf(number);
+
+    entry->references--;
+
+    if (entry->references > 0)
+        return;
+
+    struct PooledNumber **link = &(pool->buckets[entry->hash & (pool->bucketCount - 1)]);
+
+    while ((*link) != entry)
+        link = &((*link)->next);
+
+    (*link) = entry->next;
+    pool->count--;
+
+    arenaFree(pool->arena, entry, sizeof(struct PooledNumber) + entry->length + 1);
+}
+
+size_t numberPoolLength(const char *number) {
+
+    return pooledNumberOf(number)->length;
+}
@@ -0,0 +1,88 @@
+/** @file
+ * Interfejs puli numerów, w której każdy numer bazy przekierowań jest przechowywany raz
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#ifndef __NUMBER_POOL_H__
+#define __NUMBER_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/** @brief Numer przechowywany w puli.
+ * Napis numeru leży w pamięci zaraz za nagłówkiem, więc z wskaźnika na napis
+ * można wyznaczyć wskaźnik na nagłówek.
+ */
+struct PooledNumber {
+
+    struct PooledNumber *next; /**< wskaźnik na następny numer w tym samym kubełku */
+    uint64_t hash; /**< skrót numeru */
+    size_t length; /**< długość numeru */
+    size_t references; /**< liczba miejsc w bazie, które odwołują się do numeru */
+    char digits[]; /**< napis numeru zakończony znakiem '\0' */
+};
+
+/** @brief Pula numerów jednej bazy przekierowań.
+ * Tablica z haszowaniem z listami w kubełkach. Każdy numer występuje w puli co najwyżej raz,
+ * więc dwa numery z puli są równe wtedy i tylko wtedy, gdy są równe ich wskaźniki.
+ * Numer jest usuwany z puli, gdy liczba odwołań do niego spadnie do zera.
+ * Cała pamięć puli pochodzi z alokatora bazy.
+ */
+struct NumberPool {
+
+    struct Arena *arena; /**< wskaźnik na alokator bazy */
+    struct PooledNumber **buckets; /**< tablica kubełków */
+    size_t bucketCount; /**< liczba kubełków, zawsze potęga dwójki */
+    size_t count; /**< liczba numerów w puli */
+};
+
+/** @brief Inicjuje pustą pulę.
+ * @param[out] pool - wskaźnik na inicjowaną pulę;
+ * @param[in,out] arena - wskaźnik na alokator, z którego pula bierze pamięć.
+ * @return Wartość @p true jeśli inicjowanie się powiodło,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+bool numberPoolInit(struct NumberPool *pool, struct Arena *arena);
+
+/** @brief Wyznacza numer z puli równy podanemu napisowi i zwiększa liczbę odwołań do niego.
+ * Jeśli numeru nie ma w puli, jest do niej dodawany.
+ * @param[in,out] pool - wskaźnik na pulę;
+ * @param[in] num - wskaźnik na napis numeru;
+ * @param[in] length - długość numeru.
+ * @return Wskaźnik na napis numeru w puli lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+const char *numberPoolAcquire(struct NumberPool *pool, const char *num, size_t length);
+
+/** @brief Wyszukuje numer w puli bez zmiany liczby odwołań.
+ * @param[in] pool - wskaźnik na pulę;
+ * @param[in] num - wskaźnik na napis numeru;
+ * @param[in] length - długość numeru.
+ * @return Wskaźnik na napis numeru w puli lub NULL, jeśli numeru nie ma w puli.
+ */
+const char *numberPoolFind(const struct NumberPool *pool, const char *num, size_t length);
+
+/** @brief Zwiększa liczbę odwołań do numeru z puli.
+ * @param[in] number - wskaźnik na napis numeru w puli.
+ */
+void numberPoolRetain(const char *number);
+
+/** @brief Zmniejsza liczbę odwołań do numeru z puli.
+ * Numer, do którego nie ma już odwołań, jest usuwany z puli, a jego pamięć zwalniana.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in,out] pool - wskaźnik na pulę;
+ * @param[in] number - wskaźnik na napis numeru w puli.
+ */
+void numberPoolRelease(struct NumberPool *pool, const char *number);
+
+/** @brief Zwraca długość numeru z puli.
+ * @param[in] number - wskaźnik na napis numeru w puli.
+ * @return Długość numeru.
+ */
+size_t numberPoolLength(const char *number);
+
+#endif /* __NUMBER_POOL_H__ */
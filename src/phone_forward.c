@@ -6,733 +6,4797 @@
  * @date 09.04.2018
  */
 
+#define _POSIX_C_SOURCE 200809L /**< udostępnia funkcje POSIX przy kompilacji w trybie C11 */
+
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <unistd.h>
 #include "phone_forward.h"
 
-#define TO 0 /**<definiuje, że ma zostać dodane przekierowanie z danego numeru */
-#define FROM 1 /**<definiuje, że ma zostać dodane przekierowanie na dany numeru */
 #define NUMBER_OF_DIGITS 12 /**<liczba znaków uznawanych za cyfry */
-#define NUMBER 0 /**<definiuję, że z listy ma być usunięty tylko konkretny numer */
-#define PREFIX 1 /**<definiuję, że listy mają być usunięte wszystkie elementy o danym prefiksie */
-
-struct PhoneForward * phfwdNew(void) {
+#define NODE_CAPACITY_LEAF 0 /**<liczba miejsc na synów w liściu */
+#define NODE_CAPACITY_SMALL 1 /**<liczba miejsc na synów w najmniejszym rodzaju węzła, który nie jest liściem */
+#define NODE_CAPACITY_MEDIUM 4 /**<liczba miejsc na synów w średnim rodzaju węzła */
+#define NODE_CAPACITY_LARGE NUMBER_OF_DIGITS /**<liczba miejsc na synów w największym rodzaju węzła */
+#define MAX_LABEL_LENGTH UINT32_MAX /**<maksymalna długość etykiety krawędzi */
+#define ALL_DIGITS ((1u << NUMBER_OF_DIGITS) - 1) /**<maska wszystkich cyfr */
+#define STARTING_RESULT_COUNT 16 /**<początkowy rozmiar tablic budowanego ciągu numerów */
+#define GET_BATCH_WIDTH 16 /**<liczba wyszukiwań prowadzonych jednocześnie przez @ref phfwdGetBatch */
+#define POWER_TABLE_SIZE 64 /**<liczba głębokości, dla których potęgi przy zliczaniu są brane z tablicy */
+#define RADIX_SORT_CUTOFF 32 /**<liczba przekierowań porcji, poniżej której są sortowane przez wstawianie */
+#define COUNT_TASKS_PER_THREAD 8 /**<liczba zadań na wątek, do której równoległe zliczanie dzieli drzewo */
+#define COUNT_MAX_SPLIT_DEPTH 4 /**<maksymalna liczba poziomów węzłów, o które równoległe zliczanie schodzi przy podziale drzewa */
+#define COUNT_CACHE_HASH_MULTIPLIER 31u /**<mnożnik maski cyfr przy wyznaczaniu miejsca w pamięci wyników zliczania */
+#define SAVE_MAGIC 0x53574650u /**<pierwsze cztery bajty zapisu bazy, w pamięci "PFWS" na maszynie little-endian */
+#define SAVE_VERSION 1u /**<wersja formatu zapisu bazy */
+#define SAVE_BUFFER_SIZE 65536 /**<rozmiar bufora przy zapisie i odczycie bazy */
+#define SAVE_FLAG_FORWARD 1u /**<znacznik węzła, który jest przekierowany */
+#define SAVE_FLAG_TARGET 2u /**<znacznik węzła, na który coś się przekierowuje */
+#define RECLAIM_THRESHOLD 64 /**<liczba zwolnionych bloków, po której wątek zmieniający bazę próbuje oddać je do ponownego użycia */
+
+#ifdef __GNUC__
+#define PREFETCH(address) __builtin_prefetch(address) /**<zleca pobranie danych spod adresu do pamięci podręcznej */
+#else
+#define PREFETCH(address) ((void) (address)) /**<kompilator nie udostępnia pobierania z wyprzedzeniem */
+#endif
+
+#ifdef __GNUC__
+#define LOAD_ACQUIRE(place) __atomic_load_n(&(place), __ATOMIC_ACQUIRE) /**<odczytuje wartość opublikowaną przez @ref STORE_RELEASE */
+#define STORE_RELEASE(place, value) __atomic_store_n(&(place), (value), __ATOMIC_RELEASE) /**<publikuje wartość razem ze wszystkim, co zapisano przed nią */
+#define LOAD_SEQ_CST(place) __atomic_load_n(&(place), __ATOMIC_SEQ_CST) /**<odczytuje wartość w jednym porządku ze wszystkimi operacjami na epokach */
+#define STORE_SEQ_CST(place, value) __atomic_store_n(&(place), (value), __ATOMIC_SEQ_CST) /**<zapisuje wartość w jednym porządku ze wszystkimi operacjami na epokach */
+#define FETCH_ADD(place, value) __atomic_fetch_add(&(place), (value), __ATOMIC_SEQ_CST) /**<atomowo zwiększa wartość i zwraca wartość sprzed zmiany */
+#define COMPARE_EXCHANGE(place, expected, desired) \
+    __atomic_compare_exchange_n(&(place), &(expected), (desired), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) /**<atomowo zastępuje oczekiwaną wartość */
+#define ATOMIC_OR(place, value) ((void) __atomic_fetch_or(&(place), (value), __ATOMIC_RELAXED)) /**<atomowo zapala bity */
+#define ATOMIC_AND(place, value) ((void) __atomic_fetch_and(&(place), (value), __ATOMIC_RELAXED)) /**<atomowo gasi bity */
+#else
+#define LOAD_ACQUIRE(place) (place) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define STORE_RELEASE(place, value) ((place) = (value)) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define LOAD_SEQ_CST(place) (place) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define STORE_SEQ_CST(place, value) ((place) = (value)) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define FETCH_ADD(place, value) (((place) += (value)) - (value)) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define COMPARE_EXCHANGE(place, expected, desired) \
+    ((place) == (expected) ? ((place) = (desired), true) : ((expected) = (place), false)) /**<bez operacji atomowych bazy nie można czytać współbieżnie ze zmianami */
+#define ATOMIC_OR(place, value) ((void) ((place) |= (value))) /**<bez operacji atomowych bazy nie można zmieniać współbieżnie */
+#define ATOMIC_AND(place, value) ((void) ((place) &= (value))) /**<bez operacji atomowych bazy nie można zmieniać współbieżnie */
+#endif
+
+/** @brief Licznik, z którego kolejne wątki czytające biorą miejsce, od którego szukają wolnego miejsca czytelnika.
+ */
+static size_t nextReaderHint = 0;
 
-    struct PhoneForward *pf = malloc(sizeof(struct PhoneForward));
+/** @brief Zlicza zapalone bity maski.
+ * @param[in] mask - maska bitowa.
+ * @return Liczba zapalonych bitów.
+ */
+static int countBits(unsigned mask) {
 
-    if (pf != NULL) {
-        pf->fwdTo = NULL;
-        for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
-            pf->children[i] = NULL;
-        }
+#ifdef __GNUC__
+    return __builtin_popcount(mask);
+#else
+    int result = 0;
 
-        pf->fwdFrom = NULL;
+    while (mask != 0) {
+        mask &= mask - 1;
+        result++;
     }
 
-    return pf;
+    return result;
+#endif
 }
 
-void phnumDelete(struct PhoneNumbers const *pnum) {
+/** @brief Wyznacza pozycję syna w tablicy synów węzła.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] digit - cyfra, dla której szukamy pozycji.
+ * @return Pozycja, na której leży (lub leżałby) syn dla danej cyfry.
+ */
+static int childIndex(const struct ForwardNode *node, int digit) {
 
-    const struct PhoneNumbers *list = pnum;
+    return countBits(node->occupancy & ((1u << digit) - 1));
+}
 
-    while (list != NULL) {
-        const struct PhoneNumbers *tmp = list;
-        list = list->next;
+/** @brief Zwraca syna węzła dla podanej cyfry.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] digit - cyfra.
+ * @return Wskaźnik na syna lub NULL, jeśli węzeł nie ma syna dla tej cyfry.
+ */
+static struct ForwardNode *getChild(const struct ForwardNode *node, int digit) {
 
-        if (tmp->number != NULL)
-            free(tmp->number);
+    if ((node->occupancy & (1u << digit)) == 0)
+        return NULL;
 
-        free((void *) tmp);
-    }
+    return node->children[childIndex(node, digit)];
 }
 
-/** @brief Usuwa z listy wszystkie elementy zawierające numer o podanym prefiksie.
- * @param[in,out] pnum - adres wskaźnika na listę, z której usuwamy;
- * @param[in,out] prefix - wskaźnik na napis z jakim element ma być usunięty z listy.
+/** @brief Zwraca adres miejsca w tablicy synów, w którym leży syn dla podanej cyfry.
+ * Adres jest ważny tylko do najbliższej zmiany zbioru synów węzła.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] digit - cyfra.
+ * @return Adres miejsca lub NULL, jeśli węzeł nie ma syna dla tej cyfry.
  */
-static void deletePrefixFromList(struct PhoneNumbers **pnum, const char* prefix) {
+static struct ForwardNode **getChildSlot(struct ForwardNode *node, int digit) {
 
-    if ((*pnum) != NULL) {
+    if ((node->occupancy & (1u << digit)) == 0)
+        return NULL;
 
-        size_t prefixLen = strlen(prefix);
+    return &(node->children[childIndex(node, digit)]);
+}
 
-        while ((*pnum) != NULL && strncmp((*pnum)->number, prefix, prefixLen) == 0) {
+/** @brief Zwraca etykietę krawędzi prowadzącej do węzła.
+ * @param[in] node - wskaźnik na węzeł.
+ * @return Wskaźnik na pierwszy znak etykiety (etykieta nie jest zakończona znakiem '\0').
+ */
+static char *nodeLabel(struct ForwardNode *node) {
 
-            struct PhoneNumbers *tmp = (*pnum)->next;
-            if((*pnum)->number != NULL)
-                free((*pnum)->number);
-            free(*pnum);
-            (*pnum) = tmp;
-        }
+    return (char *) &(node->children[node->capacity]);
+}
 
-        if ((*pnum) != NULL) {
+/** @brief Zwraca syna węzła dla podanej cyfry, gdy węzeł może być zmieniany przez inny wątek.
+ * Wątek zmieniający bazę przesuwa synów w tablicy przed zmianą maski @p occupancy, więc
+ * odczyt maski sprzed zmiany może wskazać pozycję, na której leży już inny syn. Każda
+ * etykieta zaczyna się od cyfry syna, więc taki odczyt jest rozpoznawany i powtarzany.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] digit - cyfra.
+ * @return Wskaźnik na syna lub NULL, jeśli węzeł nie ma syna dla tej cyfry.
+ */
+static struct ForwardNode *readChild(struct ForwardNode *node, int digit) {
 
-            struct PhoneNumbers *tmp = (*pnum)->next;
-            struct PhoneNumbers *prev = (*pnum);
+    while (true) {
 
-            while (tmp != NULL) {
+        uint16_t occupancy = LOAD_ACQUIRE(node->occupancy);
 
-                while (tmp != NULL && strncmp(tmp->number, prefix, prefixLen) != 0) {
-                    tmp = tmp->next;
-                    prev = prev->next;
-                }
+        if ((occupancy & (1u << digit)) == 0)
+            return NULL;
 
-                if (tmp != NULL) {
+        struct ForwardNode *child = LOAD_ACQUIRE(node->children[countBits(occupancy & ((1u << digit) - 1))]);
 
-                    prev->next = tmp->next;
-                    if (tmp->number != NULL)
-                        free(tmp->number);
-                    free(tmp);
-                    tmp = prev->next;
-                }
-            }
-        }
+        if (nodeLabel(child)[0] == '0' + digit)
+            return child;
     }
 }
 
-/** @brief Usuwa z listy element o danym zapisanym napisie.
- * @param[in,out] pnum - adres wskaźnika na listę, z której usuwamy;
- * @param[in,out] num - wskaźnik na napis z jakim element ma być usunięty z listy.
+/** @brief Wyznacza rozmiar węzła.
+ * @param[in] capacity - liczba miejsc na synów;
+ * @param[in] labelLength - długość etykiety.
+ * @return Rozmiar węzła w bajtach.
  */
-static void deleteNumFromList(struct PhoneNumbers **pnum, const char* num) {
-
-    if ((*pnum) != NULL) {
+static size_t nodeSize(uint8_t capacity, size_t labelLength) {
 
-        if (strcmp((*pnum)->number, num) == 0) {
-
-            struct PhoneNumbers *tmp = (*pnum)->next;
-            if((*pnum)->number != NULL)
-                free((*pnum)->number);
-            free(*pnum);
-            (*pnum) = tmp;
-        }
+    return sizeof(struct ForwardNode) + capacity * sizeof(struct ForwardNode *) + labelLength;
+}
 
-        else {
-            struct PhoneNumbers *tmp = (*pnum)->next;
-            struct PhoneNumbers *prev = (*pnum);
+/** @brief Tworzy nowy pusty węzeł.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in] capacity - liczba miejsc na synów;
+ * @param[in] label - wskaźnik na etykietę krawędzi prowadzącej do węzła lub NULL,
+ *                    jeśli etykieta zostanie uzupełniona później;
+ * @param[in] labelLength - długość etykiety.
+ * @return Wskaźnik na utworzony węzeł lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ForwardNode *nodeNew(struct Arena *arena, uint8_t capacity, const char *label, size_t labelLength) {
+
+    struct ForwardNode *node = arenaAlloc(arena, nodeSize(capacity, labelLength));
+
+    if (node != NULL) {
+        node->fwdTo = NULL;
+        node->fwdFrom = NULL;
+        node->fwdEntry = NULL;
+        node->parent = NULL;
+        node->labelLength = (uint32_t) labelLength;
+        node->occupancy = 0;
+        node->reverseMask = 0;
+        node->capacity = capacity;
+        if (label != NULL)
+            memcpy(nodeLabel(node), label, labelLength);
+    }
 
-            while (tmp != NULL && strcmp(tmp->number, num) != 0) {
-                tmp = tmp->next;
-                prev = prev->next;
-            }
+    return node;
+}
 
-            if (tmp != NULL) {
+/** @brief Zwalnia pojedynczy węzeł.
+ * Nie zwalnia synów węzła ani jego napisów.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] node - wskaźnik na zwalniany węzeł.
+ */
+static void nodeFree(struct Arena *arena, struct ForwardNode *node) {
 
-                prev->next = tmp->next;
-                if (tmp->number != NULL)
-                    free(tmp->number);
-                free(tmp);
-            }
-        }
-    }
+    arenaFree(arena, node, nodeSize(node->capacity, node->labelLength));
 }
 
-void phfwdDelete(struct PhoneForward *pf) {
-
-    if (pf != NULL) {
+/** @brief Wyznacza najmniejszy rodzaj węzła mieszczący podaną liczbę synów.
+ * @param[in] count - liczba synów.
+ * @return Liczba miejsc na synów w wybranym rodzaju węzła.
+ */
+static uint8_t fittingCapacity(int count) {
 
-        for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
-            phfwdDelete(pf->children[i]);
-        }
+    if (count <= NODE_CAPACITY_LEAF)
+        return NODE_CAPACITY_LEAF;
 
-        if (pf->fwdTo != NULL) {
-            free(pf->fwdTo);
-            pf->fwdTo = NULL;
-        }
+    if (count <= NODE_CAPACITY_SMALL)
+        return NODE_CAPACITY_SMALL;
 
-        if (pf->fwdFrom != NULL) {
-            phnumDelete(pf->fwdFrom);
-            pf->fwdFrom = NULL;
-        }
+    if (count <= NODE_CAPACITY_MEDIUM)
+        return NODE_CAPACITY_MEDIUM;
 
-        free(pf);
-    }
+    return NODE_CAPACITY_LARGE;
 }
 
-/** @brief Sprawdza czy znak jest cyfrą.
- * Sprawdza czy znak jest cyfrą według wymogów zadania.
- * @param ch - sprawdzany znak.
- * @return Wartość @p true jeśli znak jest cyfrą,
- *         wartość @p false jeśli znak nie jest cyfrą.
+/** @brief Aktualizuje wskaźniki na węzeł po przeniesieniu go w inne miejsce pamięci.
+ * Synowie węzła i jego lista przekierowań na węzeł zaczynają wskazywać na jego nowe położenie.
+ * @param[in,out] node - wskaźnik na przeniesiony węzeł.
  */
-static bool isDigit(char ch) {
+static void nodeAdopt(struct ForwardNode *node) {
 
-    return (ch >= '0' && ch <= ';');
+    int count = countBits(node->occupancy);
+
+    for (int i = 0; i < count; i++)
+        node->children[i]->parent = node;
+
+    if (node->fwdFrom != NULL)
+        node->fwdFrom->owner = node;
 }
 
-/** @brief Sprawdza czy napis jest numerem telefonu
- * Sprawdza czy podany w argumencie napis jest poprawnie zapisanym numerem telefonu
- * (według wymogów zadania).
- * @param[in] num - wskaźnik na sprawdzany napis.
- * @return Wartość @p true, jeśli napis jest poprawni zapisanym numerem.
- *         Wartość @p false, gdy napis nie reprezentuje numeru.
+/** @brief Przenosi węzeł do węzła innego rodzaju lub o innej etykiecie.
+ * Tworzy węzeł o podanej liczbie miejsc na synów i podanej etykiecie, przenosi do niego
+ * zawartość węzła @p node i zwalnia @p node.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] node - wskaźnik na przenoszony węzeł;
+ * @param[in] capacity - liczba miejsc na synów w nowym węźle;
+ * @param[in] label - wskaźnik na etykietę nowego węzła;
+ * @param[in] labelLength - długość etykiety nowego węzła.
+ * @return Wskaźnik na nowy węzeł lub NULL, gdy nie udało się zaalokować pamięci
+ *         (wtedy @p node pozostaje nienaruszony).
  */
-static bool checkIfNumber(const char *num) {
-
-    int i = 0;
+static struct ForwardNode *nodeRebuild(struct Arena *arena, struct ForwardNode *node, uint8_t capacity, const char *label, size_t labelLength) {
 
-    if (num == NULL || num[0] == '\0')
-        return false;
+    struct ForwardNode *resized = nodeNew(arena, capacity, label, labelLength);
 
-    while (num[i] != '\0') {
-        if (isDigit(num[i]) == 0)
-            return false;
-        i++;
-    }
+    if (resized == NULL)
+        return NULL;
 
-    return true;
+    resized->fwdTo = node->fwdTo;
+    resized->fwdFrom = node->fwdFrom;
+    resized->fwdEntry = node->fwdEntry;
+    resized->parent = node->parent;
+    resized->occupancy = node->occupancy;
+    resized->reverseMask = node->reverseMask;
+    memcpy(resized->children, node->children, countBits(node->occupancy) * sizeof(struct ForwardNode *));
+    nodeAdopt(resized);
+    nodeFree(arena, node);
+
+    return resized;
 }
 
-/** @brief Konwertuje znak liczbowy na wartość.
- * @param[in] ch - konwertowany znak.
- * @return Wartość znaku.
+/** @brief Przenosi węzeł do węzła innego rodzaju.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] node - wskaźnik na przenoszony węzeł;
+ * @param[in] capacity - liczba miejsc na synów w nowym węźle.
+ * @return Wskaźnik na nowy węzeł lub NULL, gdy nie udało się zaalokować pamięci
+ *         (wtedy @p node pozostaje nienaruszony).
  */
-static int charDigitToInt(char ch) {
+static struct ForwardNode *nodeResize(struct Arena *arena, struct ForwardNode *node, uint8_t capacity) {
 
-    return ch - '0';
+    return nodeRebuild(arena, node, capacity, nodeLabel(node), node->labelLength);
 }
 
-/** @brief Tworzy element listy @ref PhoneNumbers.
- * @param[in] numLength - długość napisu, który ma się mieścić w elemencie.
- * @return Wskaźnik na nowo utworzony element.
+/** @brief Dodaje syna do węzła.
+ * Jeżeli w tablicy synów nie ma miejsca, węzeł jest przenoszony do większego rodzaju,
+ * a wskaźnik pod adresem @p slot jest aktualizowany, gdy nowy węzeł jest już kompletny.
+ * Synowie są przesuwani pojedynczymi atomowymi zapisami, a maska @p occupancy zmienia się
+ * na końcu, więc wątki czytające widzą albo stary, albo nowy zbiór synów (zob. @ref readChild).
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] slot - adres wskaźnika na węzeł, do którego dodajemy syna;
+ * @param[in] digit - cyfra, dla której dodajemy syna;
+ * @param[in] child - wskaźnik na dodawanego syna.
+ * @return Wartość @p true jeśli dodanie się powiodło,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
  */
-static struct PhoneNumbers *phnumNew(size_t numLength) {
-
-    struct PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers));
+static bool addChild(struct Arena *arena, struct ForwardNode **slot, int digit, struct ForwardNode *child) {
 
-    if (pnum == NULL)
-        return pnum;
+    struct ForwardNode *node = *slot;
+    int count = countBits(node->occupancy);
 
-    pnum->next = NULL;
-    pnum->number = malloc(sizeof(char) * (numLength + 1));
+    if (count == node->capacity) {
 
-    if (pnum->number == NULL) {
-        free(pnum);
-        return NULL;
+        node = nodeResize(arena, node, fittingCapacity(count + 1));
+        if (node == NULL)
+            return false;
     }
 
-    return pnum;
-}
+    int index = childIndex(node, digit);
 
-/** @brief Tworzy pusty ciąg numerów telefonów.
- * @return Wskaźnik na powstały ciąg.
- */
-static struct PhoneNumbers *emptyPhnum() {
+    for (int i = count; i > index; i--)
+        STORE_RELEASE(node->children[i], node->children[i - 1]);
 
-    struct PhoneNumbers *empty;
-    empty = phnumNew(0);
+    STORE_RELEASE(node->children[index], child);
+    STORE_RELEASE(node->occupancy, (uint16_t) (node->occupancy | (1u << digit)));
+    child->parent = node;
 
-    if (empty != NULL)
-        empty->number[0] = '\0';
+    if (node != (*slot))
+        STORE_RELEASE((*slot), node);
 
-    return empty;
+    return true;
 }
 
-/** @brief Sprawdza czy węzeł jest pusty.
- * Sprawdza, czy wszystkie pola w danym węźle są ustawione na NULL.
- * @param[in] pf - wskaźnik na sprawdzany węzeł.
- * @return Wartość @p true jeśli węzeł jest pusty, a @p false jeśli nie.
+/** @brief Usuwa syna z tablicy synów węzła.
+ * Nie zwalnia syna i nie zmienia rodzaju węzła, więc węzeł pozostaje w tym samym miejscu pamięci.
+ * Jak w @ref addChild, synowie są przesuwani przed zmianą maski @p occupancy.
+ * @param[in,out] node - wskaźnik na węzeł;
+ * @param[in] digit - cyfra, dla której usuwamy syna.
  */
-static bool isNodeEmpty(struct PhoneForward *pf) {
+static void removeChild(struct ForwardNode *node, int digit) {
 
-    if (pf->fwdTo != NULL)
-        return false;
+    int count = countBits(node->occupancy);
+    int index = childIndex(node, digit);
 
-    if (pf->fwdFrom != NULL)
-        return false;
+    for (int i = index; i < count - 1; i++)
+        STORE_RELEASE(node->children[i], node->children[i + 1]);
 
-    for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
+    STORE_RELEASE(node->occupancy, (uint16_t) (node->occupancy & ~(1u << digit)));
+    node->reverseMask &= (uint16_t) ~(1u << digit);
+}
 
-        if (pf->children[i] != NULL)
-            return false;
-    }
+/** @brief Sprawdza, czy w poddrzewie węzła jest węzeł z niepustą listą przekierowań na niego.
+ * @param[in] node - wskaźnik na węzeł.
+ * @return Wartość @p true jeśli w poddrzewie jest taki węzeł,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool hasReverseEntries(const struct ForwardNode *node) {
 
-    return true;
+    return (node->fwdFrom != NULL || node->reverseMask != 0);
 }
 
-/** @brief Usuwa odpowiedni prefiks z listy przekierowujących się na drugi podany prefiks.
- * Znajduje, w drzewie prefiks wskazywany przez @p num i usuwa z jego list prefiksów,
- * które się na niego przekierowują element zawierający napis wskazywany przez @p numDel.
- * @param[in,out] pf - wskaźnik na drzewo przekierowań;
- * @param[in] num - wskaźnik na napis reprezentujący prefiks z którego usuwamy;
- * @param[in] numDel - wskaźnik na prefiks, który ma być usunięty z listy prefiksów, które przekierowują się na num
- * @param[in] currentDepth - aktualna głębokość w drzewie;
- * @param[in] length - długość prefiksu num;
- * @param[in] version - określa czy z listy ma być usunięty konkretny element o danym numerze, czy wszystkie z takim prefiksem.
- * @return Wartość @p true jeżeli węzeł wskazywany przez @p pf jest pusty po wykonaniu funkcji,
- *         wartość false jeżeli nie będzie pusty.
+/** @brief Aktualizuje maski @p reverseMask przodków węzła po zmianie jego listy przekierowań na niego.
+ * Idzie w stronę korzenia, dopóki zmiana wpływa na podsumowanie ojca. Maskę korzenia
+ * zmieniają wszystkie pasma, więc jej bity są zmieniane atomowo.
+ * @param[in] node - wskaźnik na węzeł, którego lista się zmieniła.
  */
-static bool phfwdRemoveRecFrom(struct PhoneForward *pf, char const *num, char const *numDel, size_t currentDepth, size_t length, int version) {
+static void updateReverseSummary(struct ForwardNode *node) {
 
-    if (pf != NULL) {
+    while (node->parent != NULL) {
 
-        if (currentDepth == length) {
-            if (version == PREFIX)
-                deletePrefixFromList(&(pf->fwdFrom), numDel);
-            if (version == NUMBER)
-                deleteNumFromList(&(pf->fwdFrom), numDel);
-            return isNodeEmpty(pf);
-        }
+        struct ForwardNode *parent = node->parent;
+        uint16_t bit = (uint16_t) (1u << (nodeLabel(node)[0] - '0'));
 
-        else {
+        if (parent->parent == NULL) {
 
-            int digit = charDigitToInt(num[currentDepth]);
+            if (hasReverseEntries(node))
+                ATOMIC_OR(parent->reverseMask, bit);
 
-            if (phfwdRemoveRecFrom(pf->children[digit], num, numDel, currentDepth + 1, length, version) == true) {
+            else
+                ATOMIC_AND(parent->reverseMask, (uint16_t) ~bit);
 
-                phfwdDelete(pf->children[digit]);
-                pf->children[digit] = NULL;
-            }
-                return isNodeEmpty(pf);
+            return;
         }
+
+        uint16_t updated = (hasReverseEntries(node) ? parent->reverseMask | bit : parent->reverseMask & (uint16_t) ~bit);
+
+        if (updated == parent->reverseMask)
+            return;
+
+        parent->reverseMask = updated;
+        node = parent;
     }
-    return false;
 }
 
-/** @brief Dodaje element o danym numerze do listy podanego węzła.
- * @param[in,out] pf - wskaźnik na węzeł, do którego dodajemy;
- * @param[in] num - numer, który ma zawierać dodawany element.
- * @return Wartość @p true jeśli udało się dodać element,
- *         wartość @p false w przeciwnym razie.
+/** @brief Przenosi węzeł do najmniejszego rodzaju mieszczącego jego synów.
+ * Jeśli nie udało się zaalokować pamięci, węzeł pozostaje w dotychczasowym rodzaju.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] slot - adres wskaźnika na węzeł.
  */
-static bool addToFromList(struct PhoneForward *pf, const char *num) {
+static void shrinkNode(struct Arena *arena, struct ForwardNode **slot) {
 
-    struct PhoneNumbers *number = phnumNew(strlen(num));
+    uint8_t capacity = fittingCapacity(countBits((*slot)->occupancy));
 
-    if (number == NULL)
-        return false;
+    if (capacity < (*slot)->capacity) {
 
-    strcpy(number->number, num);
-    number->next = pf->fwdFrom;
-    pf->fwdFrom = number;
+        struct ForwardNode *resized = nodeResize(arena, (*slot), capacity);
 
-    return true;
+        if (resized != NULL)
+            STORE_RELEASE((*slot), resized);
+    }
 }
 
-/** @brief Dodaje przekierowanie o podanym numerze do węzła
- * Dodaje do węzła o prefiksie wskazywanym przez @p num1
- * przekierowanie o numerze wskazywanym przez @p num2.
- * Jeżeli przekierowanie już było dodane do węzła, zastępuje je.
- * @param[in,out] pfRoot - wskaźnik na drzewo przekierowań;
- * @param[in,out] pf - wskaźnik na obsługiwany węzeł;
- * @param[in] num1 - wskaźnik na prefiks węzła;
- * @param[in] num2 - wskaźnik na prefiks dodawany.
- * @return Wartość @p true jeżeli dodanie się powiodło,
- *         wartość @p false w przeciwnym razie.
+/** @brief Przywraca zwartą postać węzła, który nie jest korzeniem.
+ * Węzeł bez przekierowań i z jednym synem jest scalany z synem w jeden węzeł o złączonej
+ * etykiecie. Pozostałe węzły są przenoszone do najmniejszego rodzaju mieszczącego ich synów.
+ * Jeśli nie udało się zaalokować pamięci, węzeł pozostaje bez zmian.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in,out] slot - adres wskaźnika na węzeł.
  */
-static bool addForward(struct PhoneForward *pfRoot, struct PhoneForward *pf, char const *num1, char const *num2) {
-
-    if (pf->fwdTo != NULL) {
-        phfwdRemoveRecFrom(pfRoot, pf->fwdTo, num1, 0, strlen(pf->fwdTo), NUMBER);
-        free(pf->fwdTo);
-    }
-
-    pf->fwdTo = malloc(sizeof(char) * (strlen(num2) + 1));
+static void compactNode(struct Arena *arena, struct ForwardNode **slot) {
 
-    if (pf->fwdTo == NULL)
-        return false;
-
-    strcpy(pf->fwdTo, num2);
+    struct ForwardNode *node = (*slot);
 
-    return true;
-}
+    if (node->fwdTo == NULL && node->fwdFrom == NULL && countBits(node->occupancy) == 1) {
 
-/** @brief Dodaje przekierowanie z węzła, bądź do jego listy przekierowań, które na niego przechodzą.
- * Funkcja znajduje węzeł reprezentujący prefiks wskazywany przez @p num1.
- * Następnie w zależności o parametru version dodaje prefiks wskazywany przez @p num2 jako
- * numer, na który przekierowuje się prefiks z węzła (version == TO) lub dodaje prefiks
- * wskazywany przez @p num2 do list prefiksów, które przekierowują się na węzeł (version == FROM).
- * @param[in,out] pf - wskaźnik na drzewo przekierowań, do którego dodajemy;
- * @param[in] num1 - wskaźnik na prefiks, do którego dodajemy;
- * @param[in] num2 - wskaźnik na prefiks, który dodajemy
- * @param[in] version - definiuje wersje działania funkcji.
- * @return Wartość @p true jeżeli dodanie powiodło się,
- *         wartość @p false w przeciwnym przypadku.
- */
-bool phfwdAddHelper(struct PhoneForward *pf, char const *num1, char const *num2, int version) {
+        struct ForwardNode *child = node->children[0];
+        size_t labelLength = (size_t) node->labelLength + child->labelLength;
 
-    struct PhoneForward *tmp = pf;
-    size_t length = strlen(num1);
-    int digit;
+        if (labelLength > MAX_LABEL_LENGTH)
+            return;
 
-    for (size_t i = 0; i < length; i++) {
+        struct ForwardNode *merged = nodeNew(arena, child->capacity, NULL, labelLength);
 
-        digit = charDigitToInt(num1[i]);
-        if (tmp->children[digit] == NULL) {
+        if (merged == NULL)
+            return;
 
-            tmp->children[digit] = phfwdNew();
-            if (tmp->children[digit] == NULL)
-                return false;
-        }
+        memcpy(nodeLabel(merged), nodeLabel(node), node->labelLength);
+        memcpy(nodeLabel(merged) + node->labelLength, nodeLabel(child), child->labelLength);
+        merged->fwdTo = child->fwdTo;
+        merged->fwdFrom = child->fwdFrom;
+        merged->fwdEntry = child->fwdEntry;
+        merged->parent = node->parent;
+        merged->occupancy = child->occupancy;
+        merged->reverseMask = child->reverseMask;
+        memcpy(merged->children, child->children, countBits(child->occupancy) * sizeof(struct ForwardNode *));
+        nodeAdopt(merged);
 
-        tmp = tmp->children[digit];
+        nodeFree(arena, child);
+        nodeFree(arena, node);
+        STORE_RELEASE((*slot), merged);
     }
 
-    if (version == 1)
-        return addToFromList(tmp, num2);
-
     else
-        return addForward(pf, tmp, num1, num2);
+        shrinkNode(arena, slot);
 }
 
-bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2) {
-
-    if (!checkIfNumber(num1) || !checkIfNumber(num2))
-        return false;
+/** @brief Sprawdza, czy etykieta węzła zgadza się z fragmentem numeru.
+ * Porównywana jest część etykiety, która mieści się w numerze.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] position - pozycja w numerze, od której porównujemy;
+ * @param[in] length - długość numeru.
+ * @return Wartość @p true jeśli etykieta zgadza się z numerem,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool labelMatches(struct ForwardNode *node, char const *num, size_t position, size_t length) {
 
-    if (strcmp(num1, num2) == 0)
-        return false;
+    size_t compared = length - position;
 
-    if (!phfwdAddHelper(pf, num1, num2, TO))
-        return false;
+    if (compared > node->labelLength)
+        compared = node->labelLength;
 
-    return phfwdAddHelper(pf, num2, num1, FROM);
+    return (memcmp(nodeLabel(node), num + position, compared) == 0);
 }
 
-/** @brief Usuwa wszystkie przekierowania z danego poddrzewa.
- * Przechodzi po drzewie i usuwa wszystkie znalezione przekierowania.
- * Gdy jakieś znajdzie to przed jego usunięciem wywołuje funkcję, która usunie dane przekierowanie
- * z listy węzła, na który jest przekierowanie.
- * @param[in,out] rootPf - wskaźnik na korzeń drzewa przekierowań;
- * @param[in,out] pf - wskaźnik na aktualnie obsługiwany węzeł;
- * @param[in] num - napis reprezentujący prefiks, z którym przekierowania są usuwane.
- * @return Wartość @p true jeżeli po wywołaniu funkcji dla synów aktualnego węzła jest on pusty.
- *         Wartość @p false jeżeli po takim wywołaniu aktualny węzeł nie jest pusty.
+/** @brief Sprawdza, czy etykieta węzła mieści się w numerze i w całości się z nim zgadza.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] position - pozycja w numerze, od której porównujemy;
+ * @param[in] length - długość numeru.
+ * @return Wartość @p true jeśli numer przechodzi przez cały węzeł,
+ *         wartość @p false w przeciwnym razie.
  */
-static bool removeForwardsFromSubtree(struct PhoneForward *rootPf, struct PhoneForward *pf, const char *num) {
+static bool labelFullyMatches(struct ForwardNode *node, char const *num, size_t position, size_t length) {
 
-    if (pf == NULL) {
-
-        return false;
-    }
+    return (node->labelLength <= length - position && labelMatches(node, num, position, length));
+}
 
-    else {
+/** @brief Zajmuje miejsce czytelnika przed przeglądaniem bazy.
+ * Wątek zaczyna szukać wolnego miejsca od miejsca, które zajmował ostatnio, więc różne
+ * wątki zwykle od razu trafiają na różne miejsca. Gdy wszystkie miejsca są zajęte,
+ * czeka, aż któreś się zwolni. Po zajęciu miejsca wpisuje do niego bieżącą epokę,
+ * powtarzając wpis, dopóki epoka zmienia się w trakcie.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @return Wskaźnik na zajęte miejsce.
+ */
+static struct ReaderSlot *readBegin(struct PhoneForward *pf) {
 
-        if (pf->fwdTo != NULL) {
-            phfwdRemoveRecFrom(rootPf, pf->fwdTo, num, 0, strlen(pf->fwdTo), PREFIX);
-        }
+    static _Thread_local size_t hint = READER_SLOTS;
 
-        for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
-            if (removeForwardsFromSubtree(rootPf, pf->children[i], num) == true) {
-                phfwdDelete(pf->children[i]);
-                pf->children[i] = NULL;
-            }
-        }
+    if (hint == READER_SLOTS)
+        hint = FETCH_ADD(nextReaderHint, 1) % READER_SLOTS;
 
-        if (pf->fwdTo != NULL) {
-            char *tmp = pf->fwdTo;
-            free(tmp);
-            pf->fwdTo = NULL;
-        }
+    uint64_t epoch = LOAD_SEQ_CST(pf->epoch);
+    uint64_t expected = 0;
 
-        return isNodeEmpty(pf);
+    while (!COMPARE_EXCHANGE(pf->readers[hint].epoch, expected, epoch)) {
+        expected = 0;
+        hint = (hint + 1) % READER_SLOTS;
     }
-}
 
-/** @brief Usuwa wszystkie przekierowania o podanym prefiks.
- * Funkcja znajduje w drzewie węzeł odpowiadający prefiksowi wskazywanemu przez @p num.
- * Następnie usuwa wszystkie przekierowania z węzłów z poddrzewa, którego korzeniem jest znalexiony węzęł
- * @param[in,out] rootPf - wskaźnik na korzeń drzewa przekierowań;
- * @param[in,out] pf - wskaźnik na obsługiwany aktualnie węzeł;
- * @param[in] num - wskaźnik na usuwany prefiks;
- * @param[in] currentDepth - głębokość obsługiwanego węzła w drzewie;
- * @param[in] length - długość usuwanego prefiksu.
- * @return Wartość @p true jeśli węzeł wskazywany przez @p pf jest pusty po wykonaniu na nim funkcji.
- *         Wartość @p false jeśli nie dalej nie będzie pusty.
- */
-static bool phfwdRemoveRecTo(struct PhoneForward *rootPf, struct PhoneForward *pf, char const *num, size_t currentDepth, size_t length) {
+    struct ReaderSlot *slot = &(pf->readers[hint]);
+    uint64_t current;
 
-    if (pf != NULL) {
+    /* Bloki zamknięte w epoce, która zaczęła się przed wpisem, mogłyby zostać oddane do
+     * ponownego użycia, zanim wątek zmieniający bazę zobaczy zajęte miejsce. */
+    while ((current = LOAD_SEQ_CST(pf->epoch)) != epoch) {
+        epoch = current;
+        STORE_SEQ_CST(slot->epoch, epoch);
+    }
 
-        if (currentDepth == length) {
+    return slot;
+}
 
-            return removeForwardsFromSubtree(rootPf, pf, num);
-        }
+/** @brief Zwalnia miejsce czytelnika po zakończeniu przeglądania bazy.
+ * @param[in,out] slot - wskaźnik na miejsce zajęte przez @ref readBegin.
+ */
+static void readEnd(struct ReaderSlot *slot) {
 
-        else {
+    STORE_RELEASE(slot->epoch, (uint64_t) 0);
+}
 
-            int digit = charDigitToInt(num[currentDepth]);
+/** @brief Sprawdza, czy wszyscy obecni czytelnicy zaczęli odczyt nie wcześniej niż w podanej epoce.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] epoch - epoka.
+ * @return Wartość @p true jeśli żaden czytelnik nie zaczął odczytu przed epoką @p epoch,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool readersPassed(struct PhoneForward *pf, uint64_t epoch) {
 
-            if (phfwdRemoveRecTo(rootPf, pf->children[digit], num, currentDepth + 1, length) == true) {
+    for (size_t i = 0; i < READER_SLOTS; i++) {
 
-                phfwdDelete(pf->children[digit]);
-                pf->children[digit] = NULL;
+        uint64_t observed = LOAD_SEQ_CST(pf->readers[i].epoch);
 
-                return isNodeEmpty(pf);
-            }
-        }
+        if (observed != 0 && observed < epoch)
+            return false;
     }
 
-    return false;
+    return true;
 }
 
-void phfwdRemove(struct PhoneForward *pf, char const *num) {
-
-    if (checkIfNumber(num) == true) {
-
-        size_t length = strlen(num);
-        phfwdRemoveRecTo(pf, pf, num, 0, length);
-    }
-}
+/** @brief Oddaje do ponownego użycia zwolnione bloki alokatora, których nie może już widzieć żaden czytelnik.
+ * Wywoływana po zmianach pamięci alokatora, pod blokadą, która go chroni. Gdy zebrało się
+ * dość zwolnionych bloków, zamknięta wcześniej grupa jest oddawana do ponownego użycia,
+ * jeśli czytelnicy ją minęli, a bieżąca grupa jest zamykana ze zwiększeniem epoki. Bloki
+ * bieżącej grupy zostały już odłączone od drzewa, więc czytelnik, który zobaczy nową
+ * epokę, nie może do nich dotrzeć.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] arena - wskaźnik na alokator;
+ * @param[in,out] sealedEpoch - wskaźnik na epokę zamknięcia grupy alokatora.
+ */
+static void reclaimRetired(struct PhoneForward *pf, struct Arena *arena, uint64_t *sealedEpoch) {
 
-struct PhoneNumbers const * phfwdGet(struct PhoneForward *pf, char const *num) {
+    if (arena->retiredCount < RECLAIM_THRESHOLD)
+        return;
 
-    struct PhoneNumbers *numbers = NULL;
+    if (arena->sealed != NULL && readersPassed(pf, (*sealedEpoch)))
+        arenaReclaim(arena);
 
-    if (checkIfNumber(num) == false)
-        return emptyPhnum();
+    if (arenaSeal(arena))
+        (*sealedEpoch) = FETCH_ADD(pf->epoch, 1) + 1;
+}
 
-    char *bestMatch = NULL;
-    size_t bestMatchLength = 0;
-    bool endOfBranch = false;
-    size_t length = strlen(num);
+/** @brief Uzupełnia korzeń o pustych synów dla cyfr, dla których nie ma syna.
+ * Każdy pusty syn ma jednoznakową etykietę i należy do pasma swojej cyfry.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @return Wartość @p true jeśli się udało,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool rootComplete(struct PhoneForward *pf) {
 
-    for (size_t i = 0; i < length && !endOfBranch; i++) {
-        int digit = charDigitToInt(num[i]);
+    for (int digit = 0; digit < WRITER_STRIPES; digit++) {
 
-        if (pf->children[digit] == NULL)
-            endOfBranch = true;
+        if (getChild(pf->root, digit) == NULL) {
 
-        else {
+            char label = (char) ('0' + digit);
+            struct Arena *arena = &(pf->stripes[digit].arena);
+            struct ForwardNode *leaf = nodeNew(arena, NODE_CAPACITY_LEAF, &label, 1);
 
-            if (pf->children[digit]->fwdTo != NULL) {
-                bestMatch = pf->children[digit]->fwdTo;
-                bestMatchLength = i + 1;
+            if (leaf == NULL || !addChild(&(pf->arena), &(pf->root), digit, leaf)) {
+                if (leaf != NULL)
+                    nodeFree(arena, leaf);
+                return false;
             }
-
-            pf = pf->children[digit];
         }
     }
 
-    if (bestMatch == NULL) {
-        numbers = phnumNew(length);
+    return true;
+}
 
-        if(numbers == NULL)
-            return NULL;
+/** @brief Zwalnia alokatory bazy, niszczy jej blokady i kończy pracę jej wątków.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania.
+ */
+static void releaseStorage(struct PhoneForward *pf) {
 
-        strcpy(numbers->number, num);
-        return numbers;
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+        arenaRelease(&(pf->stripes[i].arena));
+        pthread_mutex_destroy(&(pf->stripes[i].lock));
     }
 
-    numbers = phnumNew(length -bestMatchLength + strlen(bestMatch));
+    arenaRelease(&(pf->arena));
+    pthread_mutex_destroy(&(pf->numbersLock));
+    workerPoolDestroy(&(pf->countPool));
+    free(pf->readers);
+}
 
-    if(numbers == NULL)
-        return NULL;
+struct PhoneForward * phfwdNew(void) {
 
-    strcpy(numbers->number, bestMatch);
-    strcpy(numbers->number + strlen(bestMatch), num + bestMatchLength);
+    struct PhoneForward *pf = malloc(sizeof(struct PhoneForward));
 
-    return numbers;
-}
+    if (pf != NULL) {
 
-/** @brief Dodaje element do listy leksykograficznie
- * Dodaje do listy posortowanej leksykograficznie element w odpowiednim miejscu zachowując posortowanie.
- * Jeżeli taki element znajduje się już w liście, zwalnia go.
- * @param[in,out] list - adres wskaźnika na listę, do której chcemy dodać element.
- * @param[in,out] element - element dodawany do listy.
- */
-static void addToListLex(struct PhoneNumbers **list, struct PhoneNumbers *element) {
+        arenaInit(&(pf->arena));
+        pthread_mutex_init(&(pf->numbersLock), NULL);
+        workerPoolInit(&(pf->countPool));
 
-    if ((*list) == NULL)
-        (*list) = element;
+        for (int i = 0; i < WRITER_STRIPES; i++) {
+            arenaInit(&(pf->stripes[i].arena));
+            pthread_mutex_init(&(pf->stripes[i].lock), NULL);
+            pf->stripes[i].sealedEpoch = 0;
+        }
 
-    else {
-        int difference = strcmp((*list)->number, element->number);
+        pf->root = nodeNew(&(pf->arena), NODE_CAPACITY_LARGE, NULL, 0);
+        pf->readers = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct ReaderSlot) * READER_SLOTS);
 
-        if (difference > 0) {
-            element->next = (*list);
-            (*list) = element;
+        if (pf->root == NULL || pf->readers == NULL || !rootComplete(pf)
+            || !numberPoolInit(&(pf->numbers), &(pf->arena))) {
+            releaseStorage(pf);
+            free(pf);
+            return NULL;
         }
 
-        else if (difference == 0) {
-            free(element->number);
-            free(element);
-        }
+        pf->generation = 1;
+        memset(pf->countCache, 0, sizeof(pf->countCache));
+        memset(pf->readers, 0, sizeof(struct ReaderSlot) * READER_SLOTS);
+        pf->epoch = 1;
+        pf->sealedEpoch = 0;
+    }
 
-        else if (strcmp((*list)->number, element->number) < 0) {
+    return pf;
+}
 
-            struct PhoneNumbers *tmp = *list;
-            while (tmp->next != NULL && strcmp(tmp->next->number, element->number) < 0)
-                tmp = tmp->next;
+void phnumDelete(struct PhoneNumbers const *pnum) {
 
-            if (tmp->next == NULL) {
-                struct PhoneNumbers *tmp2 = tmp->next;
-                tmp->next = element;
-                element->next = tmp2;
-            }
+    free((void *) pnum);
+}
 
-            else if(strcmp(tmp->next->number, element->number) == 0) {
-                free(element->number);
-                free(element);
-            }
+/** @brief Tworzy element listy przekierowań na węzeł.
+ * Element przejmuje jedno odwołanie do numeru z puli.
+ * @param[in,out] arena - wskaźnik na alokator bazy;
+ * @param[in] number - wskaźnik na numer z puli, który ma zawierać element.
+ * @return Wskaźnik na nowy element lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ReverseEntry *reverseEntryNew(struct Arena *arena, const char *number) {
 
-            else {
-                struct PhoneNumbers *tmp2 = tmp->next;
-                tmp->next = element;
-                element->next = tmp2;
-            }
-        }
+    struct ReverseEntry *element = arenaAlloc(arena, sizeof(struct ReverseEntry));
+
+    if (element != NULL) {
+        element->next = NULL;
+        element->prev = NULL;
+        element->list = NULL;
+        element->number = number;
+        element->published = false;
     }
+
+    return element;
 }
 
+/** @brief Wstawia numer do puli numerów bazy pod blokadą puli.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na cyfry numeru;
+ * @param[in] length - liczba cyfr numeru.
+ * @return Wskaźnik na numer w puli lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static const char *numberAcquire(struct PhoneForward *pf, const char *num, size_t length) {
+
+    pthread_mutex_lock(&(pf->numbersLock));
 
-struct PhoneNumbers const * phfwdReverse(struct PhoneForward *pf, char const *num) {
+    const char *number = numberPoolAcquire(&(pf->numbers), num, length);
 
-    if(checkIfNumber(num) == false)
-        return emptyPhnum();
+    pthread_mutex_unlock(&(pf->numbersLock));
 
-    struct PhoneNumbers *list = NULL;
-    bool endOfBranch = false;
-    struct PhoneForward *tmp = pf;
-    size_t length = strlen(num);
+    return number;
+}
 
-    list = phnumNew(length + 1);
-    strcpy(list->number, num);
+/** @brief Oddaje odwołanie do numeru z puli numerów bazy pod blokadą puli.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] number - wskaźnik na numer z puli.
+ */
+static void numberRelease(struct PhoneForward *pf, const char *number) {
 
-    for(size_t i = 0; i < length && !endOfBranch; i++) {
+    if (number == NULL)
+        return;
 
-        int index = charDigitToInt(num[i]);
+    pthread_mutex_lock(&(pf->numbersLock));
+    numberPoolRelease(&(pf->numbers), number);
+    reclaimRetired(pf, &(pf->arena), &(pf->sealedEpoch));
+    pthread_mutex_unlock(&(pf->numbersLock));
+}
 
-        if (tmp->children[index] == NULL)
-            endOfBranch = true;
+/** @brief Zwalnia element listy przekierowań na węzeł.
+ * Oddaje odwołanie elementu do numeru z puli.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] element - wskaźnik na zwalniany element.
+ */
+static void reverseEntryFree(struct PhoneForward *pf, struct ReverseEntry *element) {
 
-        else {
-            tmp = tmp->children[index];
+    numberRelease(pf, element->number);
+    arenaFree(element->list->arena, element, sizeof(struct ReverseEntry));
+}
 
-            struct PhoneNumbers *nodeList = tmp->fwdFrom;
+void phfwdDelete(struct PhoneForward *pf) {
 
-            while (nodeList != NULL) {
+    if (pf != NULL) {
 
-                struct PhoneNumbers *newNumber = phnumNew(length - i + 1 + strlen(nodeList->number) + 1);
-                strcpy(newNumber->number, nodeList->number);
-                strcpy((newNumber->number) + strlen(nodeList->number), num + (i +1));
-                addToListLex(&list, newNumber);
-                nodeList = nodeList->next;
-            }
-        }
+        releaseStorage(pf);
+        free(pf);
     }
-
-    return list;
 }
 
-char const * phnumGet(struct PhoneNumbers const *pnum, size_t idx) {
-
-    if (pnum != NULL && pnum->number[0] == '\0')
+/** @brief Sprawdza czy znak jest cyfrą.
+ * Sprawdza czy znak jest cyfrą według wymogów zadania.
+ * @param ch - sprawdzany znak.
+ * @return Wartość @p true jeśli znak jest cyfrą,
+ *         wartość @p false jeśli znak nie jest cyfrą.
+ */
+static bool isDigit(char ch) {
+
+    return (ch >= '0' && ch <= ';');
+}
+
+/** @brief Sprawdza czy napis jest numerem telefonu
+ * Sprawdza czy podany w argumencie napis jest poprawnie zapisanym numerem telefonu
+ * (według wymogów zadania).
+ * @param[in] num - wskaźnik na sprawdzany napis.
+ * @return Wartość @p true, jeśli napis jest poprawni zapisanym numerem.
+ *         Wartość @p false, gdy napis nie reprezentuje numeru.
+ */
+static bool checkIfNumber(const char *num) {
+
+    int i = 0;
+
+    if (num == NULL || num[0] == '\0')
+        return false;
+
+    while (num[i] != '\0') {
+        if (isDigit(num[i]) == 0)
+            return false;
+        i++;
+    }
+
+    return true;
+}
+
+/** @brief Konwertuje znak liczbowy na wartość.
+ * @param[in] ch - konwertowany znak.
+ * @return Wartość znaku.
+ */
+static int charDigitToInt(char ch) {
+
+    return ch - '0';
+}
+
+/** @brief Wyznacza maskę pasma, do którego należy numer.
+ * @param[in] num - wskaźnik na niepusty numer.
+ * @return Maska z zapalonym bitem pierwszej cyfry numeru.
+ */
+static unsigned stripeOf(const char *num) {
+
+    return 1u << charDigitToInt(num[0]);
+}
+
+/** @brief Zwraca alokator pasma, do którego należy numer.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na niepusty numer.
+ * @return Wskaźnik na alokator pasma.
+ */
+static struct Arena *stripeArena(struct PhoneForward *pf, const char *num) {
+
+    return &(pf->stripes[charDigitToInt(num[0])].arena);
+}
+
+/** @brief Blokuje pasma w kolejności rosnących cyfr.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] stripes - maska blokowanych pasm.
+ */
+static void lockStripes(struct PhoneForward *pf, unsigned stripes) {
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        if (stripes & (1u << i))
+            pthread_mutex_lock(&(pf->stripes[i].lock));
+    }
+}
+
+/** @brief Oddaje do ponownego użycia zwolnione bloki pasm i odblokowuje je.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] stripes - maska zablokowanych pasm.
+ */
+static void unlockStripes(struct PhoneForward *pf, unsigned stripes) {
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        if (stripes & (1u << i)) {
+            reclaimRetired(pf, &(pf->stripes[i].arena), &(pf->stripes[i].sealedEpoch));
+            pthread_mutex_unlock(&(pf->stripes[i].lock));
+        }
+    }
+}
+
+/** @brief Funkcja wyznaczająca pasma, których dotknie zmiana bazy, poza pasmem jej prefiksu.
+ * Jest wywoływana z zablokowanym pasmem prefiksu, więc może przeglądać jego poddrzewo.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na prefiks zmiany;
+ * @param[in] length - długość prefiksu.
+ * @return Maska pasm.
+ */
+typedef unsigned (*StripeDemand)(struct PhoneForward *pf, const char *num, size_t length);
+
+/** @brief Blokuje wszystkie pasma potrzebne do zmiany bazy.
+ * Pasma, których dotknie zmiana, zależą od stanu bazy, więc są wyznaczane pod blokadą.
+ * Jeśli okaże się, że potrzebne jest pasmo spoza zablokowanych, wszystkie blokady są
+ * zwalniane i brane od nowa w kolejności rosnących cyfr, dopóki zablokowane pasma nie
+ * obejmą potrzebnych. Zbiór blokowanych pasm tylko rośnie, więc pętla się kończy.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] stripes - maska pasm, które zmiana na pewno zmieni;
+ * @param[in] demand - funkcja wyznaczająca pozostałe pasma;
+ * @param[in] num - wskaźnik na prefiks zmiany;
+ * @param[in] length - długość prefiksu.
+ * @return Maska zablokowanych pasm.
+ */
+static unsigned lockStripesFor(struct PhoneForward *pf, unsigned stripes, StripeDemand demand, const char *num, size_t length) {
+
+    lockStripes(pf, stripes);
+
+    while (true) {
+
+        unsigned needed = stripes | demand(pf, num, length);
+
+        if (needed == stripes)
+            return stripes;
+
+        unlockStripes(pf, stripes);
+        stripes = needed;
+        lockStripes(pf, stripes);
+    }
+}
+
+/** @brief Zwraca początek obszaru napisów ciągu numerów.
+ * @param[in] pnum - wskaźnik na ciąg numerów.
+ * @return Wskaźnik na pierwszy znak obszaru napisów.
+ */
+static char *phnumDigits(const struct PhoneNumbers *pnum) {
+
+    return (char *) (pnum->offsets + pnum->count);
+}
+
+/** @brief Tworzy ciąg numerów telefonów zawierający jeden numer.
+ * Numer jest złożeniem dwóch napisów.
+ * @param[in] head - wskaźnik na początek numeru;
+ * @param[in] headLength - długość początku numeru;
+ * @param[in] tail - wskaźnik na dalszą część numeru;
+ * @param[in] tailLength - długość dalszej części numeru.
+ * @return Wskaźnik na nowo utworzony ciąg lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct PhoneNumbers *phnumSingleNew(const char *head, size_t headLength, const char *tail, size_t tailLength) {
+
+    struct PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers) + sizeof(size_t) + headLength + tailLength + 1);
+
+    if (pnum == NULL)
+        return pnum;
+
+    pnum->count = 1;
+    pnum->offsets[0] = 0;
+
+    char *digits = phnumDigits(pnum);
+
+    memcpy(digits, head, headLength);
+    memcpy(digits + headLength, tail, tailLength);
+    digits[headLength + tailLength] = '\0';
+
+    return pnum;
+}
+
+/** @brief Tworzy pusty ciąg numerów telefonów.
+ * @return Wskaźnik na powstały ciąg.
+ */
+static struct PhoneNumbers *emptyPhnum() {
+
+    struct PhoneNumbers *empty = malloc(sizeof(struct PhoneNumbers));
+
+    if (empty != NULL)
+        empty->count = 0;
+
+    return empty;
+}
+
+/** @brief Budowany ciąg numerów telefonów o nieznanej z góry długości.
+ * Numery są dopisywane do rosnących tablic, a gotowy ciąg jest kopiowany
+ * do jednego bloku pamięci o dokładnym rozmiarze.
+ */
+struct PhoneNumbersBuilder {
+
+    size_t *offsets; /**< tablica pozycji kolejnych numerów w obszarze napisów */
+    size_t count; /**< liczba dopisanych numerów */
+    size_t offsetsCapacity; /**< rozmiar tablicy pozycji */
+    char *digits; /**< obszar napisów */
+    size_t digitsLength; /**< liczba zajętych bajtów obszaru napisów */
+    size_t digitsCapacity; /**< rozmiar obszaru napisów */
+};
+
+/** @brief Inicjuje pusty budowany ciąg.
+ * @param[out] builder - wskaźnik na inicjowany ciąg.
+ */
+static void phnumBuilderInit(struct PhoneNumbersBuilder *builder) {
+
+    builder->offsets = NULL;
+    builder->count = 0;
+    builder->offsetsCapacity = 0;
+    builder->digits = NULL;
+    builder->digitsLength = 0;
+    builder->digitsCapacity = 0;
+}
+
+/** @brief Zwalnia pamięć budowanego ciągu.
+ * @param[in,out] builder - wskaźnik na budowany ciąg.
+ */
+static void phnumBuilderFree(struct PhoneNumbersBuilder *builder) {
+
+    free(builder->offsets);
+    free(builder->digits);
+    phnumBuilderInit(builder);
+}
+
+/** @brief Dopisuje numer na koniec budowanego ciągu.
+ * Numer jest złożeniem dwóch napisów.
+ * @param[in,out] builder - wskaźnik na budowany ciąg;
+ * @param[in] head - wskaźnik na początek numeru;
+ * @param[in] headLength - długość początku numeru;
+ * @param[in] tail - wskaźnik na dalszą część numeru;
+ * @param[in] tailLength - długość dalszej części numeru.
+ * @return Wartość @p true jeśli udało się dopisać numer,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool phnumBuilderAppend(struct PhoneNumbersBuilder *builder, const char *head, size_t headLength,
+                               const char *tail, size_t tailLength) {
+
+    if (builder->count == builder->offsetsCapacity) {
+
+        size_t capacity = (builder->offsetsCapacity == 0 ? STARTING_RESULT_COUNT : 2 * builder->offsetsCapacity);
+        size_t *offsets = realloc(builder->offsets, sizeof(size_t) * capacity);
+
+        if (offsets == NULL)
+            return false;
+
+        builder->offsets = offsets;
+        builder->offsetsCapacity = capacity;
+    }
+
+    size_t needed = builder->digitsLength + headLength + tailLength + 1;
+
+    if (needed > builder->digitsCapacity) {
+
+        size_t capacity = (builder->digitsCapacity == 0 ? STARTING_RESULT_COUNT : 2 * builder->digitsCapacity);
+
+        while (capacity < needed)
+            capacity *= 2;
+
+        char *digits = realloc(builder->digits, capacity);
+
+        if (digits == NULL)
+            return false;
+
+        builder->digits = digits;
+        builder->digitsCapacity = capacity;
+    }
+
+    char *number = builder->digits + builder->digitsLength;
+
+    memcpy(number, head, headLength);
+    memcpy(number + headLength, tail, tailLength);
+    number[headLength + tailLength] = '\0';
+
+    builder->offsets[builder->count] = builder->digitsLength;
+    builder->count++;
+    builder->digitsLength = needed;
+
+    return true;
+}
+
+/** @brief Zwraca ostatni numer budowanego ciągu.
+ * @param[in] builder - wskaźnik na budowany ciąg.
+ * @return Wskaźnik na ostatni numer lub NULL, jeśli ciąg jest pusty.
+ */
+static const char *phnumBuilderLast(const struct PhoneNumbersBuilder *builder) {
+
+    if (builder->count == 0)
+        return NULL;
+
+    return builder->digits + builder->offsets[builder->count - 1];
+}
+
+/** @brief Kończy budowanie ciągu.
+ * Kopiuje numery do jednego bloku pamięci i zwalnia pamięć budowanego ciągu.
+ * @param[in,out] builder - wskaźnik na budowany ciąg.
+ * @return Wskaźnik na gotowy ciąg lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct PhoneNumbers *phnumBuilderFinish(struct PhoneNumbersBuilder *builder) {
+
+    struct PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers) + sizeof(size_t) * builder->count
+                                       + builder->digitsLength);
+
+    if (pnum != NULL) {
+
+        pnum->count = builder->count;
+
+        if (builder->count > 0) {
+            memcpy(pnum->offsets, builder->offsets, sizeof(size_t) * builder->count);
+            memcpy(phnumDigits(pnum), builder->digits, builder->digitsLength);
+        }
+    }
+
+    phnumBuilderFree(builder);
+
+    return pnum;
+}
+
+/** @brief Sprawdza czy węzeł jest pusty.
+ * Sprawdza, czy wszystkie pola w danym węźle są ustawione na NULL.
+ * @param[in] pf - wskaźnik na sprawdzany węzeł.
+ * @return Wartość @p true jeśli węzeł jest pusty, a @p false jeśli nie.
+ */
+static bool isNodeEmpty(struct ForwardNode *pf) {
+
+    if (pf->fwdTo != NULL)
+        return false;
+
+    if (pf->fwdFrom != NULL)
+        return false;
+
+    return (pf->occupancy == 0);
+}
+
+/** @brief Stan iteracyjnego przechodzenia poddrzewa.
+ * Przechodzenie nie używa rekurencji ani dodatkowej pamięci: drogę powrotną wyznaczają
+ * wskaźniki na ojców, więc głębokość drzewa, nawet przy bardzo długich numerach,
+ * nie wpływa na zużycie stosu.
+ */
+struct TreeWalk {
+
+    struct ForwardNode *top; /**< wskaźnik na korzeń przechodzonego poddrzewa */
+    struct ForwardNode *node; /**< wskaźnik na bieżący węzeł */
+    size_t depth; /**< długość prefiksu reprezentowanego przez bieżący węzeł */
+    unsigned digits; /**< maska cyfr, po których wolno schodzić do synów */
+    bool reverseOnly; /**< czy schodzić tylko do synów, w których poddrzewach są listy przekierowań na węzły */
+};
+
+/** @brief Rozpoczyna przechodzenie poddrzewa.
+ * @param[out] walk - wskaźnik na stan przechodzenia;
+ * @param[in] top - wskaźnik na korzeń poddrzewa, który jest pierwszym bieżącym węzłem;
+ * @param[in] depth - długość prefiksu reprezentowanego przez korzeń poddrzewa;
+ * @param[in] digits - maska cyfr, po których wolno schodzić do synów;
+ * @param[in] reverseOnly - czy schodzić tylko do synów, w których poddrzewach są listy przekierowań na węzły.
+ */
+static void walkStart(struct TreeWalk *walk, struct ForwardNode *top, size_t depth, unsigned digits, bool reverseOnly) {
+
+    walk->top = top;
+    walk->node = top;
+    walk->depth = depth;
+    walk->digits = digits;
+    walk->reverseOnly = reverseOnly;
+}
+
+/** @brief Schodzi do pierwszego dozwolonego syna bieżącego węzła o cyfrze większej niż podana.
+ * @param[in,out] walk - wskaźnik na stan przechodzenia;
+ * @param[in] digit - cyfra, po której szukamy syna, lub -1, aby szukać od najmniejszej cyfry.
+ * @return Wartość @p true jeśli bieżącym węzłem stał się znaleziony syn,
+ *         wartość @p false jeśli takiego syna nie ma.
+ */
+static bool walkChildAfter(struct TreeWalk *walk, int digit) {
+
+    unsigned above = (digit < 0 ? ~0u : ~((2u << digit) - 1));
+    unsigned children = (walk->reverseOnly ? walk->node->reverseMask : walk->node->occupancy);
+    unsigned candidates = children & walk->digits & above;
+
+    if (candidates == 0)
+        return false;
+
+    struct ForwardNode *child = getChild(walk->node, countBits((candidates & (~candidates + 1)) - 1));
+
+    walk->node = child;
+    walk->depth += child->labelLength;
+
+    return true;
+}
+
+/** @brief Schodzi z bieżącego węzła do najgłębszego węzła po skrajnie lewej dozwolonej ścieżce.
+ * @param[in,out] walk - wskaźnik na stan przechodzenia.
+ */
+static void walkLeftmost(struct TreeWalk *walk) {
+
+    while (walkChildAfter(walk, -1))
+        ;
+}
+
+/** @brief Wraca z bieżącego węzła do jego ojca.
+ * Po powrocie opuszczony węzeł może zostać zwolniony lub przeniesiony.
+ * @param[in,out] walk - wskaźnik na stan przechodzenia.
+ * @return Cyfra, pod którą opuszczony węzeł jest zapisany u ojca, lub -1,
+ *         jeśli bieżący węzeł jest korzeniem poddrzewa (wtedy nic się nie zmienia).
+ */
+static int walkUp(struct TreeWalk *walk) {
+
+    struct ForwardNode *node = walk->node;
+
+    if (node == walk->top)
+        return -1;
+
+    walk->depth -= node->labelLength;
+    walk->node = node->parent;
+
+    return charDigitToInt(nodeLabel(node)[0]);
+}
+
+/** @brief Usuwa puste węzły, idąc od podanego węzła w stronę korzenia.
+ * Węzły nie zmieniają rodzaju, bo funkcja może być wywołana w trakcie przechodzenia
+ * poddrzewa, które trzyma wskaźniki na węzły. Korzeń i jego synowie nigdy nie są usuwani.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] arena - wskaźnik na alokator pasma węzła;
+ * @param[in,out] node - wskaźnik na węzeł, od którego zaczynamy.
+ */
+static void pruneEmptyNodes(struct PhoneForward *rootPf, struct Arena *arena, struct ForwardNode *node) {
+
+    while (node != rootPf->root && node->parent != rootPf->root && isNodeEmpty(node)) {
+
+        struct ForwardNode *parent = node->parent;
+
+        removeChild(parent, charDigitToInt(nodeLabel(node)[0]));
+        nodeFree(arena, node);
+        node = parent;
+    }
+}
+
+/** @brief Tworzy pustą listę przekierowań na węzeł, jeśli węzeł jej nie ma.
+ * @param[in,out] arena - wskaźnik na alokator pasma węzła;
+ * @param[in,out] node - wskaźnik na węzeł.
+ * @return Wskaźnik na listę węzła lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ReverseList *reverseListOf(struct Arena *arena, struct ForwardNode *node) {
+
+    if (node->fwdFrom == NULL) {
+
+        struct ReverseList *list = arenaAlloc(arena, sizeof(struct ReverseList));
+
+        if (list == NULL)
+            return NULL;
+
+        list->head = NULL;
+        list->last = NULL;
+        list->pending = NULL;
+        list->owner = node;
+        list->arena = arena;
+        list->sorted = true;
+        STORE_RELEASE(node->fwdFrom, list);
+        updateReverseSummary(node);
+    }
+
+    return node->fwdFrom;
+}
+
+/** @brief Zwalnia listę przekierowań na węzeł, jeśli jest pusta.
+ * @param[in,out] list - wskaźnik na listę.
+ * @return Wartość @p true jeśli lista była pusta i została zwolniona,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool reverseListFreeIfEmpty(struct ReverseList *list) {
+
+    if (list->head != NULL || list->pending != NULL)
+        return false;
+
+    STORE_RELEASE(list->owner->fwdFrom, NULL);
+    updateReverseSummary(list->owner);
+    arenaFree(list->arena, list, sizeof(struct ReverseList));
+
+    return true;
+}
+
+/** @brief Dopisuje element do listy przekierowań na węzeł.
+ * Element nie mniejszy od ostatniego elementu części posortowanej jest dopisywany na jej
+ * koniec i publikowany dla wątków czytających listę jednym zapisem, dopiero po wypełnieniu.
+ * Pozostałe elementy trafiają do elementów oczekujących, a lista jest oznaczana jako
+ * nieposortowana i zostanie posortowana przez @ref reverseListSort.
+ * @param[in,out] list - wskaźnik na listę;
+ * @param[in,out] entry - wskaźnik na dopisywany element.
+ */
+static void reverseListAppend(struct ReverseList *list, struct ReverseEntry *entry) {
+
+    entry->list = list;
+
+    if (list->last == NULL || strcmp(list->last->number, entry->number) <= 0) {
+
+        entry->published = true;
+        entry->prev = list->last;
+        entry->next = NULL;
+
+        if (list->last == NULL)
+            STORE_RELEASE(list->head, entry);
+
+        else
+            STORE_RELEASE(list->last->next, entry);
+
+        list->last = entry;
+    }
+
+    else {
+
+        entry->published = false;
+        entry->prev = NULL;
+        entry->next = list->pending;
+
+        if (list->pending != NULL)
+            list->pending->prev = entry;
+
+        list->pending = entry;
+        STORE_RELEASE(list->sorted, false);
+    }
+}
+
+/** @brief Sortuje leksykograficznie ciąg elementów połączonych wskaźnikami @p next.
+ * Sortowanie przez scalanie w miejscu, bez dodatkowej pamięci. Wskaźniki @p prev
+ * elementów nie są ustawiane.
+ * @param[in,out] head - wskaźnik na pierwszy element ciągu.
+ * @return Wskaźnik na pierwszy element posortowanego ciągu.
+ */
+static struct ReverseEntry *sortEntries(struct ReverseEntry *head) {
+
+    struct ReverseEntry *tail = NULL;
+    size_t runLength = 1;
+    size_t merges = 0;
+
+    do {
+
+        struct ReverseEntry *left = head;
+        head = NULL;
+        tail = NULL;
+        merges = 0;
+
+        while (left != NULL) {
+
+            struct ReverseEntry *right = left;
+            size_t leftSize = 0;
+            size_t rightSize = runLength;
+
+            merges++;
+
+            while (leftSize < runLength && right != NULL) {
+                leftSize++;
+                right = right->next;
+            }
+
+            while (leftSize > 0 || (rightSize > 0 && right != NULL)) {
+
+                struct ReverseEntry *element;
+
+                if (leftSize == 0 || (rightSize > 0 && right != NULL && strcmp(right->number, left->number) < 0)) {
+                    element = right;
+                    right = right->next;
+                    rightSize--;
+                }
+
+                else {
+                    element = left;
+                    left = left->next;
+                    leftSize--;
+                }
+
+                if (tail != NULL)
+                    tail->next = element;
+
+                else
+                    head = element;
+
+                tail = element;
+            }
+
+            left = right;
+        }
+
+        if (tail != NULL)
+            tail->next = NULL;
+
+        runLength *= 2;
+
+    } while (merges > 1);
+
+    return head;
+}
+
+/** @brief Wstawia oczekujące elementy listy przekierowań na węzeł do jej części posortowanej.
+ * Oczekujące elementy są najpierw sortowane, a potem wstawiane w jednym przejściu części
+ * posortowanej. Każdy z nich jest publikowany jednym zapisem, a elementy części
+ * posortowanej nie zmieniają kolejności, więc wątek czytający listę w tym czasie widzi
+ * ją zawsze posortowaną. Wymaga blokady pasma węzła. Nic nie robi, jeśli lista nie ma
+ * elementów oczekujących.
+ * @param[in,out] list - wskaźnik na listę.
+ */
+static void reverseListSort(struct ReverseList *list) {
+
+    if (list->pending == NULL)
+        return;
+
+    struct ReverseEntry *pending = sortEntries(list->pending);
+    struct ReverseEntry *position = NULL;
+    struct ReverseEntry *following = list->head;
+
+    while (pending != NULL) {
+
+        struct ReverseEntry *entry = pending;
+        pending = pending->next;
+
+        while (following != NULL && strcmp(following->number, entry->number) <= 0) {
+            position = following;
+            following = following->next;
+        }
+
+        entry->published = true;
+        entry->prev = position;
+        entry->next = following;
+
+        if (following == NULL)
+            list->last = entry;
+
+        else
+            following->prev = entry;
+
+        if (position == NULL)
+            STORE_RELEASE(list->head, entry);
+
+        else
+            STORE_RELEASE(position->next, entry);
+
+        position = entry;
+    }
+
+    list->pending = NULL;
+    STORE_RELEASE(list->sorted, true);
+}
+
+/** @brief Odłącza element od listy przekierowań na węzeł i zwalnia go.
+ * Wskaźnik @p next odłączonego elementu części posortowanej się nie zmienia, więc wątek,
+ * który czyta właśnie ten element, przejdzie dalej po liście. Elementów oczekujących
+ * wątki czytające nie widzą, więc są odłączane bez atomowych zapisów.
+ * Lista pozostaje przy węźle nawet wtedy, gdy stała się pusta.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] entry - wskaźnik na usuwany element.
+ * @return Wskaźnik na listę, z której usunięto element.
+ */
+static struct ReverseList *reverseEntryDetach(struct PhoneForward *rootPf, struct ReverseEntry *entry) {
+
+    struct ReverseList *list = entry->list;
+
+    if (!entry->published) {
+
+        if (entry->prev != NULL)
+            entry->prev->next = entry->next;
+
+        else
+            list->pending = entry->next;
+
+        if (entry->next != NULL)
+            entry->next->prev = entry->prev;
+
+        if (list->pending == NULL)
+            STORE_RELEASE(list->sorted, true);
+    }
+
+    else {
+
+        if (entry->prev != NULL)
+            STORE_RELEASE(entry->prev->next, entry->next);
+
+        else
+            STORE_RELEASE(list->head, entry->next);
+
+        if (entry->next != NULL)
+            entry->next->prev = entry->prev;
+
+        else
+            list->last = entry->prev;
+    }
+
+    reverseEntryFree(rootPf, entry);
+
+    return list;
+}
+
+/** @brief Zwalnia pustą listę przekierowań na węzeł i usuwa węzły, które przez to stały się puste.
+ * Nic nie robi, jeśli lista nie jest pusta.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] list - wskaźnik na listę.
+ */
+static void reverseListRelease(struct PhoneForward *rootPf, struct ReverseList *list) {
+
+    struct ForwardNode *owner = list->owner;
+    struct Arena *arena = list->arena;
+
+    if (reverseListFreeIfEmpty(list))
+        pruneEmptyNodes(rootPf, arena, owner);
+}
+
+/** @brief Ustawia nowe przekierowanie węzła i zwraca element listy poprzedniego celu.
+ * Nowe przekierowanie jest publikowane jednym zapisem, więc wątki czytające widzą węzeł
+ * przekierowany albo na stary, albo na nowy numer. Oddaje odwołanie do poprzedniego celu,
+ * ale nie usuwa jego elementu z listy przekierowań na węzeł.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] node - wskaźnik na przekierowany węzeł;
+ * @param[in] fwdTo - wskaźnik na numer z puli, na który węzeł ma być przekierowany;
+ * @param[in] entry - wskaźnik na element listy węzła docelowego odpowiadający nowemu przekierowaniu.
+ * @return Wskaźnik na element listy węzła poprzednio docelowego lub NULL, jeśli węzeł nie był przekierowany.
+ */
+static struct ReverseEntry *swapForward(struct PhoneForward *rootPf, struct ForwardNode *node, const char *fwdTo, struct ReverseEntry *entry) {
+
+    const char *previous = node->fwdTo;
+    struct ReverseEntry *previousEntry = node->fwdEntry;
+
+    STORE_RELEASE(node->fwdTo, fwdTo);
+    node->fwdEntry = entry;
+
+    numberRelease(rootPf, previous);
+
+    return previousEntry;
+}
+
+/** @brief Zastępuje przekierowanie węzła nowym przekierowaniem.
+ * Przekierowanie jest zmieniane przez @ref swapForward. Element listy węzła poprzednio docelowego
+ * jest usuwany bezpośrednio przez wskaźnik trzymany w węźle, bez szukania go w drzewie ani
+ * w liście. Jeśli lista stała się pusta, jest zwalniana, a węzeł, do którego należała, jest
+ * usuwany wraz z przodkami, którzy stali się puści.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] node - wskaźnik na przekierowany węzeł;
+ * @param[in] fwdTo - wskaźnik na numer z puli, na który węzeł ma być przekierowany;
+ * @param[in] entry - wskaźnik na element listy węzła docelowego odpowiadający nowemu przekierowaniu.
+ */
+static void replaceForward(struct PhoneForward *rootPf, struct ForwardNode *node, const char *fwdTo, struct ReverseEntry *entry) {
+
+    struct ReverseEntry *previousEntry = swapForward(rootPf, node, fwdTo, entry);
+
+    if (previousEntry != NULL)
+        reverseListRelease(rootPf, reverseEntryDetach(rootPf, previousEntry));
+}
+
+/** @brief Zapewnia miejsce na kolejny element rosnącej tablicy.
+ * @param[in,out] array - adres wskaźnika na tablicę;
+ * @param[in,out] capacity - wskaźnik na rozmiar tablicy;
+ * @param[in] needed - wymagana liczba elementów;
+ * @param[in] elementSize - rozmiar elementu w bajtach.
+ * @return Wartość @p true jeśli tablica ma co najmniej @p needed miejsc,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool reserveArray(void **array, size_t *capacity, size_t needed, size_t elementSize) {
+
+    if (needed <= (*capacity))
+        return true;
+
+    size_t resizedCapacity = ((*capacity) == 0 ? STARTING_RESULT_COUNT : 2 * (*capacity));
+
+    while (resizedCapacity < needed)
+        resizedCapacity *= 2;
+
+    void *resized = realloc((*array), resizedCapacity * elementSize);
+
+    if (resized == NULL)
+        return false;
+
+    (*array) = resized;
+    (*capacity) = resizedCapacity;
+
+    return true;
+}
+
+/** @brief Węzeł na ścieżce od korzenia do ostatnio wyznaczonego numeru.
+ */
+struct PathStep {
+
+    struct ForwardNode *node; /**< wskaźnik na węzeł */
+    size_t position; /**< długość prefiksu reprezentowanego przez węzeł */
+};
+
+/** @brief Ścieżka od korzenia do węzła ostatnio wyznaczonego numeru.
+ * Pozwala wyznaczać kolejne numery posortowanego ciągu bez schodzenia za każdym razem od korzenia:
+ * zejście zaczyna się od najgłębszego węzła ścieżki, który jest prefiksem także następnego numeru.
+ * Węzeł ścieżki jest zapisywany dopiero wtedy, gdy zejście go opuszcza, czyli po ostatniej zmianie,
+ * która mogła go przenieść, więc zapisane wskaźniki pozostają aktualne, dopóki drzewo zmienia tylko
+ * wyznaczanie kolejnych numerów.
+ */
+struct InsertPath {
+
+    struct PathStep *steps; /**< węzły ścieżki od korzenia */
+    size_t length; /**< liczba węzłów ścieżki */
+    size_t capacity; /**< rozmiar tablicy węzłów */
+    const char *last; /**< wskaźnik na ostatnio wyznaczony numer lub NULL */
+    size_t lastLength; /**< długość ostatnio wyznaczonego numeru */
+};
+
+/** @brief Dopisuje węzeł na koniec ścieżki.
+ * @param[in,out] path - wskaźnik na ścieżkę;
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] position - długość prefiksu reprezentowanego przez węzeł.
+ * @return Wartość @p true jeśli dopisanie się powiodło,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool pathPush(struct InsertPath *path, struct ForwardNode *node, size_t position) {
+
+    if (!reserveArray((void **) &(path->steps), &(path->capacity), path->length + 1, sizeof(struct PathStep)))
+        return false;
+
+    path->steps[path->length].node = node;
+    path->steps[path->length].position = position;
+    path->length++;
+
+    return true;
+}
+
+/** @brief Znajduje węzeł reprezentujący numer, tworząc go w razie potrzeby.
+ * Schodzi od korzenia po krawędziach zgodnych z numerem. Jeżeli numer rozchodzi się z etykietą
+ * krawędzi w jej środku, krawędź jest dzielona węzłem pośrednim. Brakujący koniec numeru
+ * staje się etykietą jednego nowego liścia.
+ * Jeśli podano ścieżkę, zejście zaczyna się od jej najgłębszego węzła, który jest prefiksem numeru,
+ * a na koniec ścieżka prowadzi do węzła numeru.
+ * Wywołujący musi blokować pasmo numeru.
+ * @param[in,out] pf - wskaźnik na drzewo przekierowań;
+ * @param[in] num - wskaźnik na niepusty numer;
+ * @param[in] length - długość numeru;
+ * @param[in,out] path - wskaźnik na ścieżkę do poprzednio wyznaczonego numeru lub NULL.
+ * @return Wskaźnik na węzeł reprezentujący numer lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ForwardNode *findOrCreateNode(struct PhoneForward *pf, char const *num, size_t length, struct InsertPath *path) {
+
+    struct Arena *arena = stripeArena(pf, num);
+    struct ForwardNode **slot = &(pf->root);
+    size_t position = 0;
+
+    if (path != NULL && path->length > 0) {
+
+        size_t common = 0;
+
+        while (common < length && common < path->lastLength && num[common] == path->last[common])
+            common++;
+
+        while (path->steps[path->length - 1].position > common)
+            path->length--;
+
+        path->length--;
+
+        struct ForwardNode *start = path->steps[path->length].node;
+        position = path->steps[path->length].position;
+
+        if (start != pf->root)
+            slot = getChildSlot(start->parent, charDigitToInt(nodeLabel(start)[0]));
+    }
+
+    if (path != NULL) {
+        path->last = NULL;
+        path->lastLength = 0;
+    }
+
+    while (position < length) {
+
+        int digit = charDigitToInt(num[position]);
+        struct ForwardNode **childSlot = getChildSlot((*slot), digit);
+
+        if (childSlot == NULL) {
+
+            size_t labelLength = length - position;
+
+            if (labelLength > MAX_LABEL_LENGTH)
+                labelLength = MAX_LABEL_LENGTH;
+
+            struct ForwardNode *leaf = nodeNew(arena, NODE_CAPACITY_LEAF, num + position, labelLength);
+            if (leaf == NULL)
+                return NULL;
+
+            if (!addChild(arena, slot, digit, leaf)) {
+                nodeFree(arena, leaf);
+                return NULL;
+            }
+
+            if (path != NULL && !pathPush(path, (*slot), position))
+                return NULL;
+
+            slot = getChildSlot((*slot), digit);
+            position += labelLength;
+            continue;
+        }
+
+        struct ForwardNode *child = (*childSlot);
+
+        /* Pustym węzłem może być tylko syn korzenia, który trzyma miejsce pasma,
+         * więc zamiast dzielić jego etykietę, zastępujemy go liściem z resztą numeru. */
+        if (isNodeEmpty(child)) {
+
+            size_t labelLength = length - position;
+
+            if (labelLength > MAX_LABEL_LENGTH)
+                labelLength = MAX_LABEL_LENGTH;
+
+            struct ForwardNode *leaf = nodeRebuild(arena, child, NODE_CAPACITY_LEAF, num + position, labelLength);
+
+            if (leaf == NULL)
+                return NULL;
+
+            STORE_RELEASE((*childSlot), leaf);
+
+            if (path != NULL && !pathPush(path, (*slot), position))
+                return NULL;
+
+            slot = childSlot;
+            position += labelLength;
+            continue;
+        }
+
+        const char *label = nodeLabel(child);
+        size_t common = 0;
+
+        while (common < child->labelLength && position + common < length && label[common] == num[position + common])
+            common++;
+
+        if (common < child->labelLength) {
+
+            int childrenCount = (position + common < length ? 2 : 1);
+            struct ForwardNode *middle = nodeNew(arena, fittingCapacity(childrenCount), label, common);
+
+            if (middle == NULL)
+                return NULL;
+
+            struct ForwardNode *shortened = nodeRebuild(arena, child, child->capacity, label + common, child->labelLength - common);
+
+            if (shortened == NULL) {
+                nodeFree(arena, middle);
+                return NULL;
+            }
+
+            middle->children[0] = shortened;
+            middle->occupancy = (uint16_t) (1u << charDigitToInt(nodeLabel(shortened)[0]));
+            middle->reverseMask = (hasReverseEntries(shortened) ? middle->occupancy : 0);
+            middle->parent = (*slot);
+            shortened->parent = middle;
+            STORE_RELEASE((*childSlot), middle);
+        }
+
+        if (path != NULL && !pathPush(path, (*slot), position))
+            return NULL;
+
+        slot = childSlot;
+        position += common;
+    }
+
+    if (path != NULL) {
+
+        if (!pathPush(path, (*slot), position))
+            return NULL;
+
+        path->last = num;
+        path->lastLength = length;
+    }
+
+    return (*slot);
+}
+
+/** @brief Dodaje przekierowanie między numerami z puli.
+ * Znajduje (lub tworzy) węzły obu prefiksów, dopisuje element z prefiksem @p num1 do listy
+ * przekierowań na węzeł @p num2 i ustawia przekierowanie węzła @p num1. Jeżeli węzeł @p num1
+ * był już przekierowany, poprzednie przekierowanie jest zastępowane nowym.
+ * Oba prefiksy są numerami z puli numerów bazy. Po udanym dodaniu element listy przejmuje
+ * odwołanie do @p num1, a węzeł odwołanie do @p num2. Wywołujący musi blokować pasma obu
+ * prefiksów i pasmo poprzedniego celu przekierowania @p num1.
+ * @param[in,out] pf - wskaźnik na drzewo przekierowań, do którego dodajemy;
+ * @param[in] num1 - wskaźnik na prefiks, który przekierowujemy;
+ * @param[in] num2 - wskaźnik na prefiks, na który przekierowujemy.
+ * @return Wartość @p true jeżeli dodanie powiodło się,
+ *         wartość @p false w przeciwnym przypadku.
+ */
+bool phfwdAddHelper(struct PhoneForward *pf, char const *num1, char const *num2) {
+
+    struct ForwardNode *target = findOrCreateNode(pf, num2, numberPoolLength(num2), NULL);
+
+    if (target == NULL)
+        return false;
+
+    /* Lista nie zmienia położenia, gdy węzeł docelowy zostanie przeniesiony
+     * przy tworzeniu węzła źródłowego. */
+    struct Arena *arena = stripeArena(pf, num2);
+    struct ReverseList *list = reverseListOf(arena, target);
+
+    if (list == NULL)
+        return false;
+
+    struct ReverseEntry *entry = reverseEntryNew(arena, num1);
+    struct ForwardNode *source = (entry == NULL ? NULL : findOrCreateNode(pf, num1, numberPoolLength(num1), NULL));
+
+    if (source == NULL) {
+
+        if (entry != NULL)
+            arenaFree(arena, entry, sizeof(struct ReverseEntry));
+
+        reverseListFreeIfEmpty(list);
+        return false;
+    }
+
+    /* Nowy element jest dopisywany przed usunięciem starego, więc lista docelowa
+     * nie zostanie zwolniona, nawet jeśli to samo przekierowanie jest dodawane ponownie. */
+    reverseListAppend(list, entry);
+
+    replaceForward(pf, source, num2, entry);
+
+    return true;
+}
+
+/** @brief Wyznacza pasmo, do którego należy obecny cel przekierowania prefiksu.
+ * Jest wywoływana z zablokowanym pasmem prefiksu (zob. @ref StripeDemand).
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na prefiks;
+ * @param[in] length - długość prefiksu.
+ * @return Maska pasma celu lub zero, jeśli prefiks nie jest przekierowany.
+ */
+static unsigned forwardStripe(struct PhoneForward *pf, const char *num, size_t length) {
+
+    struct ForwardNode *node = pf->root;
+    size_t position = 0;
+
+    while (position < length) {
+
+        struct ForwardNode *child = getChild(node, charDigitToInt(num[position]));
+
+        if (child == NULL || !labelFullyMatches(child, num, position, length))
+            return 0;
+
+        position += child->labelLength;
+        node = child;
+    }
+
+    return (node->fwdTo == NULL ? 0 : stripeOf(node->fwdTo));
+}
+
+bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2) {
+
+    if (!checkIfNumber(num1) || !checkIfNumber(num2))
+        return false;
+
+    if (strcmp(num1, num2) == 0)
+        return false;
+
+    FETCH_ADD(pf->generation, 1);
+
+    size_t length = strlen(num1);
+    const char *from = numberAcquire(pf, num1, length);
+
+    if (from == NULL)
+        return false;
+
+    const char *to = numberAcquire(pf, num2, strlen(num2));
+
+    if (to == NULL) {
+        numberRelease(pf, from);
+        return false;
+    }
+
+    /* Zastąpienie przekierowania zmienia też listę poprzedniego celu. */
+    unsigned stripes = lockStripesFor(pf, stripeOf(num1) | stripeOf(num2), forwardStripe, num1, length);
+    bool added = phfwdAddHelper(pf, from, to);
+
+    unlockStripes(pf, stripes);
+
+    if (!added) {
+        numberRelease(pf, from);
+        numberRelease(pf, to);
+    }
+
+    return added;
+}
+
+/** @brief Przekierowanie dodawane przez @ref phfwdAddBatch.
+ */
+struct BatchForward {
+
+    const char *from; /**< wskaźnik na prefiks, który przekierowujemy */
+    const char *to; /**< wskaźnik na prefiks, na który przekierowujemy */
+    struct ReverseEntry *entry; /**< wskaźnik na element listy przekierowań na węzeł @p to lub NULL */
+    struct ReverseEntry *replaced; /**< wskaźnik na element listy poprzedniego celu prefiksu @p from,
+                                        który trzeba usunąć, lub NULL */
+    int replacedStripe; /**< pasmo poprzedniego celu prefiksu @p from */
+    bool applied; /**< czy przekierowanie zostało ustawione w węźle @p from */
+};
+
+/** @brief Część tablicy przekierowań porcji należąca do jednego pasma.
+ */
+struct BatchStripe {
+
+    size_t offset; /**< pozycja pierwszego przekierowania części w tablicy */
+    size_t count; /**< liczba przekierowań części */
+    bool failed; /**< czy etap nie powiódł się dla części, bo nie udało się zaalokować pamięci */
+};
+
+struct BatchBuild;
+
+/** @brief Etap dodawania porcji wykonywany osobno dla części każdego pasma.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+typedef void (*BatchStep)(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe);
+
+/** @brief Funkcja wyznaczająca pasmo, do którego należy przekierowanie porcji w danym etapie.
+ * @param[in] item - wskaźnik na przekierowanie.
+ * @return Numer pasma lub -1, jeśli przekierowanie nie bierze udziału w etapie.
+ */
+typedef int (*BatchStripeOf)(const struct BatchForward *item);
+
+/** @brief Stan dodawania porcji przez wiele wątków.
+ * Wątki biorą kolejne części pasm z licznika, więc każdą część wykonuje jeden wątek,
+ * który zmienia tylko poddrzewo i alokator jej pasma.
+ */
+struct BatchBuild {
+
+    struct PhoneForward *pf; /**< wskaźnik na bazę */
+    struct BatchForward **buffer; /**< tablica pomocnicza sortowania */
+    struct BatchForward **items; /**< tablica przekierowań wykonywanego etapu */
+    struct BatchStripe *stripes; /**< części tablicy @p items */
+    BatchStep step; /**< wykonywany etap */
+    size_t next; /**< pozycja w @p order następnej części do wykonania */
+    size_t threads; /**< największa liczba wątków */
+    int order[WRITER_STRIPES]; /**< pasma w kolejności malejących liczb przekierowań */
+};
+
+/** @brief Zwraca numer, według którego sortowane są przekierowania porcji.
+ * @param[in] item - wskaźnik na przekierowanie;
+ * @param[in] bySource - czy sortujemy według prefiksów przekierowywanych, a nie docelowych.
+ * @return Wskaźnik na numer.
+ */
+static const char *batchKey(const struct BatchForward *item, bool bySource) {
+
+    return (bySource ? item->from : item->to);
+}
+
+/** @brief Sortuje stabilnie przez wstawianie przekierowania, których numery mają wspólny prefiks.
+ * @param[in,out] items - tablica wskaźników na przekierowania;
+ * @param[in] count - liczba przekierowań;
+ * @param[in] depth - długość wspólnego prefiksu numerów;
+ * @param[in] bySource - czy sortujemy według prefiksów przekierowywanych, a nie docelowych.
+ */
+static void batchInsertionSort(struct BatchForward **items, size_t count, size_t depth, bool bySource) {
+
+    for (size_t i = 1; i < count; i++) {
+
+        struct BatchForward *item = items[i];
+        const char *key = batchKey(item, bySource) + depth;
+        size_t j = i;
+
+        while (j > 0 && strcmp(batchKey(items[j - 1], bySource) + depth, key) > 0) {
+            items[j] = items[j - 1];
+            j--;
+        }
+
+        items[j] = item;
+    }
+}
+
+/** @brief Sortuje stabilnie przekierowania porcji według numerów, cyfra po cyfrze.
+ * Przekierowania są rozdzielane według cyfry na pozycji @p depth, a numery, które się na niej
+ * kończą, trafiają przed wszystkie pozostałe. Do mniejszych grup funkcja wywołuje się rekurencyjnie,
+ * a największą sortuje dalej w pętli, więc głębokość rekurencji jest logarytmiczna względem
+ * liczby przekierowań, a nie zależy od długości numerów. Grupy mniejsze niż @ref RADIX_SORT_CUTOFF
+ * są sortowane przez wstawianie.
+ * @param[in,out] items - tablica wskaźników na przekierowania, których numery mają wspólny prefiks
+ *                        długości @p depth;
+ * @param[in,out] buffer - tablica pomocnicza o rozmiarze co najmniej @p count;
+ * @param[in] count - liczba przekierowań;
+ * @param[in] depth - długość wspólnego prefiksu numerów;
+ * @param[in] bySource - czy sortujemy według prefiksów przekierowywanych, a nie docelowych.
+ */
+static void batchRadixSort(struct BatchForward **items, struct BatchForward **buffer, size_t count, size_t depth, bool bySource) {
+
+    while (count >= RADIX_SORT_CUTOFF) {
+
+        size_t starts[NUMBER_OF_DIGITS + 1] = {0};
+        size_t counts[NUMBER_OF_DIGITS + 1] = {0};
+
+        for (size_t i = 0; i < count; i++) {
+
+            char ch = batchKey(items[i], bySource)[depth];
+            counts[ch == '\0' ? 0 : charDigitToInt(ch) + 1]++;
+        }
+
+        for (int bucket = 1; bucket <= NUMBER_OF_DIGITS; bucket++)
+            starts[bucket] = starts[bucket - 1] + counts[bucket - 1];
+
+        size_t positions[NUMBER_OF_DIGITS + 1];
+        memcpy(positions, starts, sizeof(positions));
+
+        for (size_t i = 0; i < count; i++) {
+
+            char ch = batchKey(items[i], bySource)[depth];
+            buffer[positions[ch == '\0' ? 0 : charDigitToInt(ch) + 1]++] = items[i];
+        }
+
+        memcpy(items, buffer, count * sizeof(struct BatchForward *));
+
+        int largest = 1;
+
+        for (int bucket = 2; bucket <= NUMBER_OF_DIGITS; bucket++) {
+
+            if (counts[bucket] > counts[largest])
+                largest = bucket;
+        }
+
+        for (int bucket = 1; bucket <= NUMBER_OF_DIGITS; bucket++) {
+
+            if (bucket != largest && counts[bucket] > 1)
+                batchRadixSort(items + starts[bucket], buffer, counts[bucket], depth + 1, bySource);
+        }
+
+        items += starts[largest];
+        count = counts[largest];
+        depth++;
+    }
+
+    batchInsertionSort(items, count, depth, bySource);
+}
+
+/** @brief Dopisuje elementy list przekierowań na węzły dla przekierowań porcji.
+ * Przechodzi przekierowania posortowane według prefiksów docelowych, więc każdy węzeł docelowy
+ * jest wyznaczany raz, a kolejne węzły są wyznaczane od wspólnego prefiksu z poprzednim.
+ * Listy, do których dopisano elementy, są od razu sortowane.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] items - tablica wskaźników na przekierowania posortowana według prefiksów docelowych;
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p true jeśli wszystkie elementy zostały dopisane,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool batchLinkTargets(struct PhoneForward *pf, struct BatchForward **items, size_t count) {
+
+    struct InsertPath path = {NULL, 0, 0, NULL, 0};
+    struct ReverseList *list = NULL;
+    bool linked = true;
+
+    for (size_t i = 0; i < count && linked; i++) {
+
+        struct BatchForward *item = items[i];
+
+        if (i == 0 || item->to != items[i - 1]->to) {
+
+            struct ForwardNode *target = findOrCreateNode(pf, item->to, numberPoolLength(item->to), &path);
+
+            list = (target == NULL ? NULL : reverseListOf(stripeArena(pf, item->to), target));
+
+            if (list == NULL) {
+                linked = false;
+                break;
+            }
+        }
+
+        item->entry = reverseEntryNew(list->arena, item->from);
+
+        if (item->entry == NULL) {
+            reverseListFreeIfEmpty(list);
+            linked = false;
+        }
+
+        else {
+
+            reverseListAppend(list, item->entry);
+
+            /* Przekierowania na jeden węzeł leżą obok siebie, więc jego lista jest sortowana
+             * raz, po dopisaniu ostatniego z nich. */
+            if (i + 1 == count || items[i + 1]->to != item->to)
+                reverseListSort(list);
+        }
+    }
+
+    free(path.steps);
+
+    return linked;
+}
+
+/** @brief Ustawia przekierowania porcji w węzłach prefiksów przekierowywanych.
+ * Przechodzi przekierowania posortowane według prefiksów przekierowywanych, wyznaczając kolejne
+ * węzły od wspólnego prefiksu z poprzednim. Elementy list poprzednich celów zastępowanych
+ * przekierowań leżą w dowolnych pasmach, więc są tylko zapamiętywane w przekierowaniach porcji.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] items - tablica wskaźników na przekierowania z dopisanymi elementami list,
+ *                        posortowana według prefiksów przekierowywanych;
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p true jeśli wszystkie przekierowania zostały ustawione,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool batchSetSources(struct PhoneForward *pf, struct BatchForward **items, size_t count) {
+
+    struct InsertPath path = {NULL, 0, 0, NULL, 0};
+    bool applied = true;
+
+    for (size_t i = 0; i < count && applied; i++) {
+
+        struct BatchForward *item = items[i];
+        struct ForwardNode *source = findOrCreateNode(pf, item->from, numberPoolLength(item->from), &path);
+
+        if (source == NULL)
+            applied = false;
+
+        else {
+
+            if (source->fwdTo != NULL)
+                item->replacedStripe = charDigitToInt(source->fwdTo[0]);
+
+            item->replaced = swapForward(pf, source, item->to, item->entry);
+            item->applied = true;
+        }
+    }
+
+    free(path.steps);
+
+    return applied;
+}
+
+/** @brief Wycofuje przekierowania porcji, które nie zostały ustawione.
+ * Usuwa ich elementy list przekierowań na węzły i oddaje ich odwołania do numerów z puli.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] items - tablica wskaźników na przekierowania;
+ * @param[in] count - liczba przekierowań.
+ */
+static void batchRollback(struct PhoneForward *pf, struct BatchForward **items, size_t count) {
+
+    for (size_t i = 0; i < count; i++) {
+
+        struct BatchForward *item = items[i];
+
+        if (item->applied)
+            continue;
+
+        if (item->entry != NULL)
+            reverseListRelease(pf, reverseEntryDetach(pf, item->entry));
+
+        else
+            numberRelease(pf, item->from);
+
+        numberRelease(pf, item->to);
+    }
+}
+
+/** @brief Wstawia numery przekierowań porcji do puli numerów bazy.
+ * Pulę blokuje raz na całą porcję. Prefiksy docelowe są wstawiane w porządku sortowania,
+ * więc powtórzenie poprzedniego prefiksu tylko zwiększa liczbę odwołań do niego, bez szukania
+ * go w puli. Jeśli zabrakło pamięci, oddaje wszystkie wzięte już odwołania.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] sources - tablica wskaźników na przekierowania o różnych prefiksach przekierowywanych;
+ * @param[in,out] targets - te same wskaźniki posortowane według prefiksów docelowych;
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p true jeśli wszystkie numery są w puli,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool batchAcquireNumbers(struct PhoneForward *pf, struct BatchForward **sources, struct BatchForward **targets, size_t count) {
+
+    size_t fromCount = 0;
+    size_t toCount = 0;
+    const char *previousRaw = NULL;
+    const char *previous = NULL;
+
+    pthread_mutex_lock(&(pf->numbersLock));
+
+    while (fromCount < count) {
+
+        const char *from = numberPoolAcquire(&(pf->numbers), sources[fromCount]->from, strlen(sources[fromCount]->from));
+
+        if (from == NULL)
+            break;
+
+        sources[fromCount]->from = from;
+        fromCount++;
+    }
+
+    while (fromCount == count && toCount < count) {
+
+        const char *raw = targets[toCount]->to;
+
+        if (previous != NULL && strcmp(raw, previousRaw) == 0)
+            numberPoolRetain(previous);
+
+        else if ((previous = numberPoolAcquire(&(pf->numbers), raw, strlen(raw))) == NULL)
+            break;
+
+        previousRaw = raw;
+        targets[toCount]->to = previous;
+        toCount++;
+    }
+
+    if (toCount < count) {
+
+        for (size_t i = 0; i < fromCount; i++)
+            numberPoolRelease(&(pf->numbers), sources[i]->from);
+
+        for (size_t i = 0; i < toCount; i++)
+            numberPoolRelease(&(pf->numbers), targets[i]->to);
+    }
+
+    reclaimRetired(pf, &(pf->arena), &(pf->sealedEpoch));
+    pthread_mutex_unlock(&(pf->numbersLock));
+
+    return (toCount == count);
+}
+
+/** @brief Zwalnia tablice używane przez @ref phfwdAddBatch.
+ * @param[in,out] items - tablica przekierowań;
+ * @param[in,out] sources - tablica wskaźników w porządku prefiksów przekierowywanych;
+ * @param[in,out] targets - tablica wskaźników w porządku prefiksów docelowych;
+ * @param[in,out] buffer - tablica pomocnicza sortowania.
+ */
+static void batchFree(struct BatchForward *items, struct BatchForward **sources, struct BatchForward **targets,
+                      struct BatchForward **buffer) {
+
+    free(items);
+    free(sources);
+    free(targets);
+    free(buffer);
+}
+
+/** @brief Wyznacza pasmo prefiksu przekierowywanego.
+ * @param[in] item - wskaźnik na przekierowanie.
+ * @return Numer pasma.
+ */
+static int batchSourceStripe(const struct BatchForward *item) {
+
+    return charDigitToInt(item->from[0]);
+}
+
+/** @brief Wyznacza pasmo prefiksu docelowego.
+ * @param[in] item - wskaźnik na przekierowanie.
+ * @return Numer pasma.
+ */
+static int batchTargetStripe(const struct BatchForward *item) {
+
+    return charDigitToInt(item->to[0]);
+}
+
+/** @brief Wyznacza pasmo elementu listy zastąpionego przekierowania.
+ * @param[in] item - wskaźnik na przekierowanie.
+ * @return Numer pasma lub -1, jeśli przekierowanie niczego nie zastąpiło.
+ */
+static int batchReplacedStripe(const struct BatchForward *item) {
+
+    return (item->replaced == NULL ? -1 : item->replacedStripe);
+}
+
+/** @brief Rozdziela stabilnie przekierowania porcji na części pasm.
+ * @param[in] input - tablica wskaźników na przekierowania;
+ * @param[out] output - tablica na przekierowania uporządkowane według pasm;
+ * @param[in] count - liczba przekierowań w @p input;
+ * @param[in] stripeOf - funkcja wyznaczająca pasmo przekierowania;
+ * @param[out] stripes - tablica @ref WRITER_STRIPES części.
+ */
+static void batchPartition(struct BatchForward **input, struct BatchForward **output, size_t count,
+                           BatchStripeOf stripeOf, struct BatchStripe *stripes) {
+
+    size_t positions[WRITER_STRIPES];
+    size_t offset = 0;
+
+    for (int i = 0; i < WRITER_STRIPES; i++)
+        stripes[i].count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+
+        int stripe = stripeOf(input[i]);
+
+        if (stripe >= 0)
+            stripes[stripe].count++;
+    }
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        stripes[i].offset = offset;
+        positions[i] = offset;
+        offset += stripes[i].count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        int stripe = stripeOf(input[i]);
+
+        if (stripe >= 0)
+            output[positions[stripe]++] = input[i];
+    }
+}
+
+/** @brief Scala części pasm na początku tablicy po usunięciu z nich przekierowań.
+ * @param[in,out] items - tablica przekierowań;
+ * @param[in,out] stripes - tablica @ref WRITER_STRIPES części.
+ * @return Liczba przekierowań we wszystkich częściach.
+ */
+static size_t batchCompact(struct BatchForward **items, struct BatchStripe *stripes) {
+
+    size_t count = 0;
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        memmove(items + count, items + stripes[i].offset, stripes[i].count * sizeof(struct BatchForward *));
+        stripes[i].offset = count;
+        count += stripes[i].count;
+    }
+
+    return count;
+}
+
+/** @brief Pętla wątku dodającego porcję.
+ * Wykonuje etap dla kolejnych niewziętych części, aż wszystkie zostaną wzięte.
+ * @param[in,out] argument - wskaźnik na stan dodawania porcji (@ref BatchBuild).
+ * @return Wartość NULL.
+ */
+static void *batchWorkerRun(void *argument) {
+
+    struct BatchBuild *build = argument;
+    size_t next;
+
+    while ((next = FETCH_ADD(build->next, 1)) < WRITER_STRIPES) {
+
+        struct BatchStripe *stripe = &(build->stripes[build->order[next]]);
+
+        if (stripe->count > 0)
+            build->step(build, build->items + stripe->offset, stripe);
+    }
+
+    return NULL;
+}
+
+/** @brief Wykonuje etap dodawania porcji dla wszystkich części.
+ * Części są brane od największej, a wątków jest co najwyżej tyle, ile niepustych części.
+ * Jeśli nie udało się uruchomić wątku, jego części wykonują pozostałe wątki.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - tablica przekierowań etapu;
+ * @param[in,out] stripes - tablica @ref WRITER_STRIPES części @p items;
+ * @param[in] step - wykonywany etap.
+ * @return Wartość @p true jeśli etap powiódł się dla wszystkich części,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool batchRun(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripes, BatchStep step) {
+
+    size_t nonEmpty = 0;
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        int j = i;
+
+        while (j > 0 && stripes[build->order[j - 1]].count < stripes[i].count) {
+            build->order[j] = build->order[j - 1];
+            j--;
+        }
+
+        build->order[j] = i;
+        stripes[i].failed = false;
+
+        if (stripes[i].count > 0)
+            nonEmpty++;
+    }
+
+    build->items = items;
+    build->stripes = stripes;
+    build->step = step;
+    build->next = 0;
+
+    size_t threads = (build->threads < nonEmpty ? build->threads : nonEmpty);
+    pthread_t workers[WRITER_STRIPES];
+    bool started[WRITER_STRIPES];
+
+    for (size_t i = 1; i < threads; i++)
+        started[i] = (pthread_create(&(workers[i]), NULL, batchWorkerRun, build) == 0);
+
+    batchWorkerRun(build);
+
+    for (size_t i = 1; i < threads; i++) {
+
+        if (started[i])
+            pthread_join(workers[i], NULL);
+    }
+
+    for (int i = 0; i < WRITER_STRIPES; i++) {
+
+        if (stripes[i].failed)
+            return false;
+    }
+
+    return true;
+}
+
+/** @brief Sortuje część prefiksów przekierowywanych i zostawia ostatnie przekierowanie każdego z nich.
+ * Sortowanie jest stabilne, więc z kilku przekierowań tego samego prefiksu
+ * ostatnie w porcji jest ostatnie w swojej grupie i tylko ono zostaje.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+static void batchSortSourcesStep(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe) {
+
+    size_t count = stripe->count;
+    size_t kept = 0;
+
+    batchRadixSort(items, build->buffer + stripe->offset, count, 1, true);
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (i + 1 < count && strcmp(items[i]->from, items[i + 1]->from) == 0)
+            continue;
+
+        items[kept] = items[i];
+        kept++;
+    }
+
+    stripe->count = kept;
+}
+
+/** @brief Sortuje część prefiksów docelowych.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+static void batchSortTargetsStep(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe) {
+
+    batchRadixSort(items, build->buffer + stripe->offset, stripe->count, 1, false);
+}
+
+/** @brief Dopisuje elementy list przekierowań na węzły części prefiksów docelowych.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+static void batchLinkStep(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe) {
+
+    stripe->failed = !batchLinkTargets(build->pf, items, stripe->count);
+}
+
+/** @brief Ustawia przekierowania części prefiksów przekierowywanych.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+static void batchSetStep(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe) {
+
+    stripe->failed = !batchSetSources(build->pf, items, stripe->count);
+}
+
+/** @brief Usuwa elementy list zastąpionych przekierowań leżące w jednym paśmie.
+ * Listy, które przez to stały się puste, są zwalniane razem z pustymi węzłami.
+ * @param[in,out] build - wskaźnik na stan dodawania porcji;
+ * @param[in,out] items - wskaźnik na pierwsze przekierowanie części;
+ * @param[in,out] stripe - wskaźnik na część.
+ */
+static void batchReleaseStep(struct BatchBuild *build, struct BatchForward **items, struct BatchStripe *stripe) {
+
+    for (size_t i = 0; i < stripe->count; i++)
+        reverseListRelease(build->pf, reverseEntryDetach(build->pf, items[i]->replaced));
+}
+
+/** @brief Dodaje porcję przekierowań na co najwyżej @p threads wątkach.
+ * Porcja jest dzielona na części według pasm. Każdy etap wykonuje się dla części równolegle,
+ * a między etapami, które zmieniają różne pasma, części są rozdzielane od nowa: sortowanie
+ * prefiksów przekierowywanych, sortowanie prefiksów docelowych, dopisanie elementów list
+ * w pasmach celów, ustawienie przekierowań w pasmach prefiksów przekierowywanych i usunięcie
+ * elementów zastąpionych przekierowań w pasmach poprzednich celów.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] pairs - tablica dodawanych przekierowań;
+ * @param[in] n - liczba przekierowań w tablicy;
+ * @param[in] threads - liczba wątków.
+ * @return Wartość zwracana przez @ref phfwdAddBatch.
+ */
+static bool addBatch(struct PhoneForward *pf, struct ForwardPair const pairs[], size_t n, size_t threads) {
+
+    if (pf == NULL || (pairs == NULL && n > 0))
+        return false;
+
+    if (n == 0)
+        return true;
+
+    struct BatchForward *items = malloc(sizeof(struct BatchForward) * n);
+    struct BatchForward **sources = malloc(sizeof(struct BatchForward *) * n);
+    struct BatchForward **targets = malloc(sizeof(struct BatchForward *) * n);
+    struct BatchForward **buffer = malloc(sizeof(struct BatchForward *) * n);
+
+    if (items == NULL || sources == NULL || targets == NULL || buffer == NULL) {
+        batchFree(items, sources, targets, buffer);
+        return false;
+    }
+
+    bool complete = true;
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+
+        if (!checkIfNumber(pairs[i].from) || !checkIfNumber(pairs[i].to) || strcmp(pairs[i].from, pairs[i].to) == 0) {
+            complete = false;
+            continue;
+        }
+
+        items[count].from = pairs[i].from;
+        items[count].to = pairs[i].to;
+        items[count].entry = NULL;
+        items[count].replaced = NULL;
+        items[count].replacedStripe = 0;
+        items[count].applied = false;
+        targets[count] = &(items[count]);
+        count++;
+    }
+
+    struct BatchBuild build;
+    struct BatchStripe sourceStripes[WRITER_STRIPES];
+    struct BatchStripe targetStripes[WRITER_STRIPES];
+    struct BatchStripe replacedStripes[WRITER_STRIPES];
+
+    build.pf = pf;
+    build.buffer = buffer;
+    build.threads = (threads < 1 ? 1 : threads);
+
+    batchPartition(targets, sources, count, batchSourceStripe, sourceStripes);
+    batchRun(&build, sources, sourceStripes, batchSortSourcesStep);
+
+    size_t kept = batchCompact(sources, sourceStripes);
+
+    if (kept > 0)
+        FETCH_ADD(pf->generation, 1);
+
+    batchPartition(sources, targets, kept, batchTargetStripe, targetStripes);
+    batchRun(&build, targets, targetStripes, batchSortTargetsStep);
+
+    if (!batchAcquireNumbers(pf, sources, targets, kept)) {
+        batchFree(items, sources, targets, buffer);
+        return false;
+    }
+
+    lockStripes(pf, ALL_DIGITS);
+
+    bool added = batchRun(&build, targets, targetStripes, batchLinkStep)
+                 && batchRun(&build, sources, sourceStripes, batchSetStep);
+
+    batchPartition(sources, buffer, kept, batchReplacedStripe, replacedStripes);
+    batchRun(&build, buffer, replacedStripes, batchReleaseStep);
+
+    if (!added)
+        batchRollback(pf, sources, kept);
+
+    unlockStripes(pf, ALL_DIGITS);
+    batchFree(items, sources, targets, buffer);
+
+    return (complete && added);
+}
+
+bool phfwdAddBatch(struct PhoneForward *pf, struct ForwardPair const pairs[], size_t n) {
+
+    return addBatch(pf, pairs, n, 1);
+}
+
+bool phfwdAddBatchParallel(struct PhoneForward *pf, struct ForwardPair const pairs[], size_t n, size_t threads) {
+
+    return addBatch(pf, pairs, n, threads);
+}
+
+/** @brief Listy przekierowań opróżnione podczas usuwania poddrzewa.
+ * Opróżnione listy zostają przy swoich węzłach do końca przechodzenia poddrzewa
+ * i są zwalniane razem, każda raz, po jego zakończeniu.
+ */
+struct RemovalBatch {
+
+    struct ReverseList **lists; /**< tablica opróżnionych list */
+    size_t count; /**< liczba list w tablicy */
+    size_t capacity; /**< rozmiar tablicy */
+};
+
+/** @brief Zapamiętuje opróżnioną listę do późniejszego zwolnienia.
+ * @param[in,out] batch - wskaźnik na zbiór opróżnionych list;
+ * @param[in] list - wskaźnik na opróżnioną listę.
+ * @return Wartość @p true jeśli udało się zapamiętać listę,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool removalBatchAdd(struct RemovalBatch *batch, struct ReverseList *list) {
+
+    if (batch->count == batch->capacity) {
+
+        size_t capacity = (batch->capacity == 0 ? STARTING_RESULT_COUNT : 2 * batch->capacity);
+        struct ReverseList **lists = realloc(batch->lists, sizeof(struct ReverseList *) * capacity);
+
+        if (lists == NULL)
+            return false;
+
+        batch->lists = lists;
+        batch->capacity = capacity;
+    }
+
+    batch->lists[batch->count] = list;
+    batch->count++;
+
+    return true;
+}
+
+/** @brief Usuwa przekierowanie z węzła w trakcie usuwania poddrzewa.
+ * Lista, która stała się pusta, nie jest zwalniana, tylko odkładana do @p batch.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] pf - wskaźnik na węzeł z przekierowaniem;
+ * @param[in,out] batch - wskaźnik na zbiór opróżnionych list.
+ */
+static void removeForwardDeferred(struct PhoneForward *rootPf, struct ForwardNode *pf, struct RemovalBatch *batch) {
+
+    struct ReverseList *list = reverseEntryDetach(rootPf, pf->fwdEntry);
+
+    /* Gdy brakuje pamięci na odłożenie listy, jest ona zwalniana od razu; usuwane są wtedy
+     * tylko puste węzły, a przodkowie węzła pf nie są puści, bo pf ma jeszcze przekierowanie. */
+    if (list->head == NULL && list->pending == NULL && !removalBatchAdd(batch, list))
+        reverseListRelease(rootPf, list);
+
+    const char *fwdTo = pf->fwdTo;
+
+    pf->fwdEntry = NULL;
+    STORE_RELEASE(pf->fwdTo, NULL);
+    numberRelease(rootPf, fwdTo);
+}
+
+/** @brief Porządkuje syna węzła po zakończeniu jego obsługi.
+ * Pusty syn jest usuwany, chyba że jest synem korzenia, a niepusty przywracany do zwartej postaci.
+ * @param[in,out] rootPf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in,out] arena - wskaźnik na alokator pasma syna;
+ * @param[in,out] pf - wskaźnik na ojca;
+ * @param[in] digit - cyfra, pod którą syn jest zapisany u ojca.
+ */
+static void tidyChild(struct PhoneForward *rootPf, struct Arena *arena, struct ForwardNode *pf, int digit) {
+
+    struct ForwardNode *child = getChild(pf, digit);
+
+    if (isNodeEmpty(child) && pf != rootPf->root) {
+        nodeFree(arena, child);
+        removeChild(pf, digit);
+    }
+
+    else
+        compactNode(arena, getChildSlot(pf, digit));
+}
+
+/** @brief Usuwa wszystkie przekierowania z danego poddrzewa.
+ * Przechodzi po drzewie w kolejności wstecznej i usuwa wszystkie znalezione przekierowania
+ * razem z ich elementami na listach węzłów, na które są przekierowania.
+ * Puści synowie są usuwani, a pozostali przywracani do zwartej postaci.
+ * Listy, które stały się puste, nie są zwalniane, tylko odkładane do @p batch.
+ * @param[in,out] rootPf - wskaźnik na korzeń drzewa przekierowań;
+ * @param[in,out] arena - wskaźnik na alokator pasma poddrzewa;
+ * @param[in,out] pf - wskaźnik na korzeń poddrzewa;
+ * @param[in,out] batch - wskaźnik na zbiór opróżnionych list.
+ */
+static void removeForwardsFromSubtree(struct PhoneForward *rootPf, struct Arena *arena, struct ForwardNode *pf,
+                                      struct RemovalBatch *batch) {
+
+    struct TreeWalk walk;
+
+    walkStart(&walk, pf, 0, ALL_DIGITS, false);
+    walkLeftmost(&walk);
+
+    while (true) {
+
+        if (walk.node->fwdTo != NULL)
+            removeForwardDeferred(rootPf, walk.node, batch);
+
+        int digit = walkUp(&walk);
+
+        if (digit < 0)
+            break;
+
+        tidyChild(rootPf, arena, walk.node, digit);
+
+        if (walkChildAfter(&walk, digit))
+            walkLeftmost(&walk);
+    }
+}
+
+/** @brief Usuwa wszystkie przekierowania o podanym prefiks.
+ * Funkcja znajduje w drzewie węzeł odpowiadający prefiksowi wskazywanemu przez @p num.
+ * Następnie usuwa wszystkie przekierowania z węzłów z poddrzewa, którego korzeniem jest znaleziony węzeł.
+ * Jeżeli prefiks kończy się w środku etykiety krawędzi, korzeniem poddrzewa jest węzeł, do którego
+ * ta krawędź prowadzi. Na koniec wraca do korzenia, usuwając puste węzły na ścieżce
+ * i przywracając pozostałe do zwartej postaci.
+ * @param[in,out] rootPf - wskaźnik na korzeń drzewa przekierowań;
+ * @param[in] num - wskaźnik na usuwany prefiks;
+ * @param[in] length - długość usuwanego prefiksu;
+ * @param[in,out] batch - wskaźnik na zbiór opróżnionych list.
+ */
+static void removePrefix(struct PhoneForward *rootPf, char const *num, size_t length, struct RemovalBatch *batch) {
+
+    struct TreeWalk walk;
+    struct Arena *arena = stripeArena(rootPf, num);
+    size_t position = 0;
+
+    walkStart(&walk, rootPf->root, 0, ALL_DIGITS, false);
+
+    while (position < length) {
+
+        struct ForwardNode *child = getChild(walk.node, charDigitToInt(num[position]));
+
+        if (child == NULL || !labelMatches(child, num, position, length))
+            break;
+
+        walk.node = child;
+        position += child->labelLength;
+    }
+
+    if (position >= length)
+        removeForwardsFromSubtree(rootPf, arena, walk.node, batch);
+
+    int digit = walkUp(&walk);
+
+    while (digit >= 0) {
+        tidyChild(rootPf, arena, walk.node, digit);
+        digit = walkUp(&walk);
+    }
+}
+
+/** @brief Wyznacza pasma, do których należą cele przekierowań usuwanych z podanym prefiksem.
+ * Jest wywoływana z zablokowanym pasmem prefiksu (zob. @ref StripeDemand).
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na prefiks;
+ * @param[in] length - długość prefiksu.
+ * @return Maska pasm celów.
+ */
+static unsigned subtreeTargetStripes(struct PhoneForward *pf, const char *num, size_t length) {
+
+    struct ForwardNode *node = pf->root;
+    size_t position = 0;
+
+    while (position < length) {
+
+        struct ForwardNode *child = getChild(node, charDigitToInt(num[position]));
+
+        if (child == NULL || !labelMatches(child, num, position, length))
+            return 0;
+
+        node = child;
+        position += child->labelLength;
+    }
+
+    unsigned stripes = 0;
+    struct TreeWalk walk;
+
+    walkStart(&walk, node, 0, ALL_DIGITS, false);
+    walkLeftmost(&walk);
+
+    while (true) {
+
+        if (walk.node->fwdTo != NULL)
+            stripes |= stripeOf(walk.node->fwdTo);
+
+        int digit = walkUp(&walk);
+
+        if (digit < 0)
+            return stripes;
+
+        if (walkChildAfter(&walk, digit))
+            walkLeftmost(&walk);
+    }
+}
+
+void phfwdRemove(struct PhoneForward *pf, char const *num) {
+
+    if (checkIfNumber(num) == true) {
+
+        size_t length = strlen(num);
+        struct RemovalBatch batch = {NULL, 0, 0};
+
+        FETCH_ADD(pf->generation, 1);
+
+        unsigned stripes = lockStripesFor(pf, stripeOf(num), subtreeTargetStripes, num, length);
+
+        removePrefix(pf, num, length, &batch);
+
+        for (size_t i = 0; i < batch.count; i++)
+            reverseListRelease(pf, batch.lists[i]);
+
+        unlockStripes(pf, stripes);
+        free(batch.lists);
+    }
+}
+
+/** @brief Wyszukuje przekierowanie najdłuższego prefiksu numeru.
+ * Wywołujący musi zajmować miejsce czytelnika, dopóki korzysta z wyniku.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num - wskaźnik na napis reprezentujący numer;
+ * @param[in] length - długość numeru;
+ * @param[out] matchLength - wskaźnik na miejsce, w które zostanie zapisana długość dopasowanego prefiksu.
+ * @return Wskaźnik na numer, na który przekierowany jest najdłuższy prefiks lub NULL,
+ *         jeśli żaden prefiks numeru nie jest przekierowany.
+ */
+static const char *findLongestForward(struct PhoneForward *pf, char const *num, size_t length, size_t *matchLength) {
+
+    const char *bestMatch = NULL;
+    bool endOfBranch = false;
+    struct ForwardNode *node = LOAD_ACQUIRE(pf->root);
+
+    size_t i = 0;
+    (*matchLength) = 0;
+
+    while (i < length && !endOfBranch) {
+        struct ForwardNode *child = readChild(node, charDigitToInt(num[i]));
+
+        if (child == NULL || !labelFullyMatches(child, num, i, length))
+            endOfBranch = true;
+
+        else {
+
+            i += child->labelLength;
+
+            const char *fwdTo = LOAD_ACQUIRE(child->fwdTo);
+
+            if (fwdTo != NULL) {
+                bestMatch = fwdTo;
+                (*matchLength) = i;
+            }
+
+            node = child;
+        }
+    }
+
+    return bestMatch;
+}
+
+/** @brief Tworzy wynik wyznaczania przekierowania numeru.
+ * @param[in] num - wskaźnik na napis reprezentujący numer;
+ * @param[in] length - długość numeru;
+ * @param[in] bestMatch - wskaźnik na numer z puli, na który przekierowany jest najdłuższy prefiks
+ *                        lub NULL, jeśli numer nie jest przekierowany;
+ * @param[in] bestMatchLength - długość przekierowanego prefiksu.
+ * @return Wskaźnik na jednoelementowy ciąg z wynikiem lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct PhoneNumbers *forwardResultNew(char const *num, size_t length, const char *bestMatch, size_t bestMatchLength) {
+
+    if (bestMatch == NULL)
+        return phnumSingleNew(num, length, "", 0);
+
+    return phnumSingleNew(bestMatch, numberPoolLength(bestMatch), num + bestMatchLength, length - bestMatchLength);
+}
+
+struct PhoneNumbers const * phfwdGet(struct PhoneForward *pf, char const *num) {
+
+    if (checkIfNumber(num) == false)
+        return emptyPhnum();
+
+    size_t length = strlen(num);
+    size_t bestMatchLength;
+    struct ReaderSlot *slot = readBegin(pf);
+    const char *bestMatch = findLongestForward(pf, num, length, &bestMatchLength);
+    struct PhoneNumbers *result = forwardResultNew(num, length, bestMatch, bestMatchLength);
+
+    readEnd(slot);
+
+    return result;
+}
+
+size_t phfwdGetInto(struct PhoneForward *pf, char const *num, char *buf, size_t cap) {
+
+    if (pf == NULL || checkIfNumber(num) == false) {
+
+        if (cap > 0)
+            buf[0] = '\0';
+
+        return 0;
+    }
+
+    size_t length = strlen(num);
+    size_t bestMatchLength;
+    struct ReaderSlot *slot = readBegin(pf);
+    const char *bestMatch = findLongestForward(pf, num, length, &bestMatchLength);
+    size_t prefixLength = (bestMatch == NULL ? 0 : numberPoolLength(bestMatch));
+    size_t resultLength = prefixLength + length - bestMatchLength;
+
+    if (resultLength < cap) {
+
+        if (bestMatch != NULL)
+            memcpy(buf, bestMatch, prefixLength);
+
+        memcpy(buf + prefixLength, num + bestMatchLength, length - bestMatchLength + 1);
+    }
+
+    readEnd(slot);
+
+    return resultLength;
+}
+
+/** @brief Stan jednego wyszukiwania prowadzonego przez @ref phfwdGetBatch.
+ */
+struct BatchLookup {
+
+    char const *num; /**< wskaźnik na szukany numer */
+    size_t length; /**< długość szukanego numeru */
+    size_t position; /**< długość prefiksu numeru, do którego doszło wyszukiwanie */
+    struct ForwardNode *node; /**< węzeł, do którego doszło wyszukiwanie */
+    struct ForwardNode *next; /**< węzeł, którego etykieta będzie sprawdzana w następnym kroku, lub NULL */
+    const char *bestMatch; /**< numer, na który przekierowany jest najdłuższy znaleziony prefiks */
+    size_t bestMatchLength; /**< długość najdłuższego znalezionego przekierowanego prefiksu */
+    size_t index; /**< indeks numeru w tablicy wejściowej */
+};
+
+/** @brief Wybiera następny węzeł wyszukiwania i zleca jego pobranie do pamięci podręcznej.
+ * Syn jest odczytywany bez sprawdzania etykiety, żeby nie czekać na jego pobranie;
+ * odczyt jest sprawdzany dopiero w następnym kroku (zob. @ref readChild).
+ * @param[in,out] lookup - wskaźnik na stan wyszukiwania;
+ * @param[in] node - wskaźnik na węzeł, do którego doszło wyszukiwanie.
+ */
+static void batchLookupAdvance(struct BatchLookup *lookup, struct ForwardNode *node) {
+
+    lookup->node = node;
+
+    if (lookup->position < lookup->length) {
+
+        int digit = charDigitToInt(lookup->num[lookup->position]);
+        uint16_t occupancy = LOAD_ACQUIRE(node->occupancy);
+
+        lookup->next = ((occupancy & (1u << digit)) == 0 ? NULL
+                        : LOAD_ACQUIRE(node->children[countBits(occupancy & ((1u << digit) - 1))]));
+        PREFETCH(lookup->next);
+    }
+
+    else
+        lookup->next = NULL;
+}
+
+/** @brief Rozpoczyna wyszukiwanie numeru z tablicy wejściowej.
+ * Napisy, które nie reprezentują numeru, od razu dostają pusty wynik.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[out] lookup - wskaźnik na stan rozpoczynanego wyszukiwania;
+ * @param[in] nums - tablica szukanych numerów;
+ * @param[in] n - liczba numerów w tablicy;
+ * @param[in,out] nextIndex - wskaźnik na indeks pierwszego nierozpoczętego wyszukiwania;
+ * @param[out] out - tablica wyników.
+ * @return Wartość @p true jeśli rozpoczęto wyszukiwanie,
+ *         wartość @p false jeśli w tablicy nie ma już numerów do wyszukania.
+ */
+static bool batchLookupStart(struct PhoneForward *pf, struct BatchLookup *lookup, char const * const nums[], size_t n,
+                             size_t *nextIndex, struct PhoneNumbers const *out[]) {
+
+    while ((*nextIndex) < n && checkIfNumber(nums[(*nextIndex)]) == false) {
+        out[(*nextIndex)] = emptyPhnum();
+        (*nextIndex)++;
+    }
+
+    if ((*nextIndex) == n)
+        return false;
+
+    lookup->index = (*nextIndex);
+    lookup->num = nums[(*nextIndex)];
+    lookup->length = strlen(lookup->num);
+    lookup->position = 0;
+    lookup->bestMatch = NULL;
+    lookup->bestMatchLength = 0;
+    batchLookupAdvance(lookup, LOAD_ACQUIRE(pf->root));
+    (*nextIndex)++;
+
+    return true;
+}
+
+void phfwdGetBatch(struct PhoneForward *pf, char const * const nums[], size_t n, struct PhoneNumbers const *out[]) {
+
+    if (pf == NULL) {
+
+        for (size_t i = 0; i < n; i++)
+            out[i] = emptyPhnum();
+
+        return;
+    }
+
+    struct BatchLookup lookups[GET_BATCH_WIDTH];
+    size_t active = 0;
+    size_t nextIndex = 0;
+    struct ReaderSlot *slot = readBegin(pf);
+
+    while (active < GET_BATCH_WIDTH && batchLookupStart(pf, &(lookups[active]), nums, n, &nextIndex, out))
+        active++;
+
+    while (active > 0) {
+
+        size_t i = 0;
+
+        while (i < active) {
+
+            struct BatchLookup *lookup = &(lookups[i]);
+            struct ForwardNode *node = lookup->next;
+
+            if (node != NULL && nodeLabel(node)[0] != lookup->num[lookup->position])
+                node = readChild(lookup->node, charDigitToInt(lookup->num[lookup->position]));
+
+            if (node != NULL && labelFullyMatches(node, lookup->num, lookup->position, lookup->length)) {
+
+                const char *fwdTo = LOAD_ACQUIRE(node->fwdTo);
+
+                lookup->position += node->labelLength;
+
+                if (fwdTo != NULL) {
+                    lookup->bestMatch = fwdTo;
+                    lookup->bestMatchLength = lookup->position;
+                }
+
+                batchLookupAdvance(lookup, node);
+                i++;
+            }
+
+            else {
+
+                out[lookup->index] = forwardResultNew(lookup->num, lookup->length, lookup->bestMatch,
+                                                      lookup->bestMatchLength);
+
+                if (!batchLookupStart(pf, lookup, nums, n, &nextIndex, out)) {
+                    active--;
+                    lookups[i] = lookups[active];
+                }
+
+                else
+                    i++;
+            }
+        }
+    }
+
+    readEnd(slot);
+}
+
+/** @brief Kandydat na kolejny numer wyniku @ref phfwdReverse.
+ * Kandydat rozwinięty reprezentuje numer @p prefix złożony z @p suffix. Kandydat nierozwinięty
+ * reprezentuje element listy przekierowań na węzeł i jego kluczem jest sam @p prefix, który jest
+ * ograniczeniem dolnym wszystkich numerów wyznaczanych przez ten i dalsze elementy posortowanej listy.
+ */
+struct ReverseCandidate {
+
+    const char *prefix; /**< wskaźnik na prefiks przekierowujący się na węzeł lub na szukany numer */
+    const char *suffix; /**< wskaźnik na część szukanego numeru za prefiksem węzła */
+    const void *entry; /**< wskaźnik na element listy (bazy lub migawki) lub NULL dla szukanego numeru */
+    bool expanded; /**< czy kandydat reprezentuje już pełny numer */
+};
+
+/** @brief Funkcja przechodząca do następnego elementu posortowanej listy przekierowań na węzeł.
+ * Pozwala scalać w ten sam sposób listy bazy i listy migawki.
+ * @param[in] context - dane potrzebne do odczytania elementu;
+ * @param[in,out] entry - adres wskaźnika na element, który zostanie przesunięty na następny element.
+ * @return Wskaźnik na numer następnego elementu lub NULL, jeśli lista się skończyła.
+ */
+typedef const char *(*ReverseNext)(const void *context, const void **entry);
+
+/** @brief Porównuje leksykograficznie dwa napisy podane jako złożenia dwóch części.
+ * @param[in] aHead - wskaźnik na początek pierwszego napisu;
+ * @param[in] aTail - wskaźnik na dalszą część pierwszego napisu;
+ * @param[in] bHead - wskaźnik na początek drugiego napisu;
+ * @param[in] bTail - wskaźnik na dalszą część drugiego napisu.
+ * @return Liczba ujemna, zero lub liczba dodatnia, jak w funkcji @p strcmp.
+ */
+static int compareJoined(const char *aHead, const char *aTail, const char *bHead, const char *bTail) {
+
+    while (true) {
+
+        if ((*aHead) == '\0' && (*aTail) != '\0') {
+            aHead = aTail;
+            aTail = "";
+        }
+
+        if ((*bHead) == '\0' && (*bTail) != '\0') {
+            bHead = bTail;
+            bTail = "";
+        }
+
+        if ((*aHead) != (*bHead) || (*aHead) == '\0')
+            return (unsigned char) (*aHead) - (unsigned char) (*bHead);
+
+        aHead++;
+        bHead++;
+    }
+}
+
+/** @brief Porównuje klucze dwóch kandydatów.
+ * @param[in] a - wskaźnik na pierwszego kandydata;
+ * @param[in] b - wskaźnik na drugiego kandydata.
+ * @return Wartość @p true jeśli klucz @p a jest mniejszy od klucza @p b.
+ */
+static bool candidateLess(const struct ReverseCandidate *a, const struct ReverseCandidate *b) {
+
+    return compareJoined(a->prefix, (a->expanded ? a->suffix : ""), b->prefix, (b->expanded ? b->suffix : "")) < 0;
+}
+
+/** @brief Przywraca własność kopca, przesuwając element w dół.
+ * @param[in,out] heap - tablica kopca;
+ * @param[in] size - liczba elementów kopca;
+ * @param[in] position - pozycja przesuwanego elementu.
+ */
+static void candidateSiftDown(struct ReverseCandidate *heap, size_t size, size_t position) {
+
+    struct ReverseCandidate moved = heap[position];
+
+    while (2 * position + 1 < size) {
+
+        size_t child = 2 * position + 1;
+
+        if (child + 1 < size && candidateLess(&(heap[child + 1]), &(heap[child])))
+            child++;
+
+        if (!candidateLess(&(heap[child]), &moved))
+            break;
+
+        heap[position] = heap[child];
+        position = child;
+    }
+
+    heap[position] = moved;
+}
+
+/** @brief Dodaje kandydata do kopca.
+ * Jeśli tablica kopca jest pełna, powiększa ją dwukrotnie.
+ * @param[in,out] heap - adres wskaźnika na tablicę kopca;
+ * @param[in,out] size - wskaźnik na liczbę elementów kopca;
+ * @param[in,out] capacity - wskaźnik na rozmiar tablicy kopca;
+ * @param[in] candidate - dodawany kandydat.
+ * @return Wartość @p true jeśli udało się dodać kandydata,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool candidatePush(struct ReverseCandidate **heap, size_t *size, size_t *capacity, struct ReverseCandidate candidate) {
+
+    if ((*size) == (*capacity)) {
+
+        struct ReverseCandidate *resized = realloc((*heap), sizeof(struct ReverseCandidate) * 2 * (*capacity));
+
+        if (resized == NULL)
+            return false;
+
+        (*heap) = resized;
+        (*capacity) *= 2;
+    }
+
+    size_t position = (*size);
+    (*size)++;
+
+    while (position > 0 && candidateLess(&candidate, &((*heap)[(position - 1) / 2]))) {
+        (*heap)[position] = (*heap)[(position - 1) / 2];
+        position = (position - 1) / 2;
+    }
+
+    (*heap)[position] = candidate;
+
+    return true;
+}
+
+/** @brief Przechodzi do następnego elementu listy przekierowań na węzeł bazy.
+ * @param[in] context - nieużywany;
+ * @param[in,out] entry - adres wskaźnika na element listy.
+ * @return Wskaźnik na numer następnego elementu lub NULL, jeśli lista się skończyła.
+ */
+static const char *reverseEntryNext(const void *context, const void **entry) {
+
+    (void) context;
+
+    const struct ReverseEntry *next = LOAD_ACQUIRE(((const struct ReverseEntry *) (*entry))->next);
+
+    (*entry) = next;
+
+    return (next == NULL ? NULL : next->number);
+}
+
+/** @brief Tworzy kopiec kandydatów zawierający szukany numer.
+ * @param[in] num - wskaźnik na napis reprezentujący szukany numer;
+ * @param[in] length - długość szukanego numeru;
+ * @param[out] heapCapacity - wskaźnik na miejsce, w które zostanie zapisany rozmiar tablicy kopca.
+ * @return Wskaźnik na tablicę kopca lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ReverseCandidate *candidateHeapNew(char const *num, size_t length, size_t *heapCapacity) {
+
+    /* Źródłami kandydatów są szukany numer i co najwyżej jeden węzeł na każdą cyfrę numeru.
+     * Źródło ma w kopcu jednego kandydata nierozwiniętego, ale rozwiniętych może mieć więcej,
+     * gdy jego prefiksy są prefiksami siebie nawzajem, więc kopiec w razie potrzeby rośnie. */
+    (*heapCapacity) = 2 * (length + 1);
+
+    struct ReverseCandidate *heap = malloc(sizeof(struct ReverseCandidate) * (*heapCapacity));
+
+    if (heap != NULL)
+        heap[0] = (struct ReverseCandidate) {num, "", NULL, true};
+
+    return heap;
+}
+
+/** @brief Scala listy przekierowań na węzły z kopca w wynik @ref phfwdReverse.
+ * Zwalnia tablicę kopca.
+ * @param[in,out] heap - tablica kopca z kandydatami początkowymi;
+ * @param[in] heapSize - liczba elementów kopca;
+ * @param[in] heapCapacity - rozmiar tablicy kopca;
+ * @param[in] next - funkcja przechodząca do następnego elementu listy;
+ * @param[in] context - dane przekazywane funkcji @p next.
+ * @return Wskaźnik na posortowany ciąg numerów bez powtórzeń lub NULL,
+ *         gdy nie udało się zaalokować pamięci.
+ */
+static struct PhoneNumbers *reverseMerge(struct ReverseCandidate *heap, size_t heapSize, size_t heapCapacity,
+                                         ReverseNext next, const void *context) {
+
+    struct PhoneNumbersBuilder result;
+    phnumBuilderInit(&result);
+
+    while (heapSize > 0) {
+
+        struct ReverseCandidate top = heap[0];
+
+        if (!top.expanded) {
+
+            heap[0].expanded = true;
+            candidateSiftDown(heap, heapSize, 0);
+
+            const void *entry = top.entry;
+            const char *number = next(context, &entry);
+
+            if (number != NULL
+                && !candidatePush(&heap, &heapSize, &heapCapacity, (struct ReverseCandidate) {number, top.suffix, entry, false})) {
+                phnumBuilderFree(&result);
+                free(heap);
+                return NULL;
+            }
+        }
+
+        else {
+
+            heapSize--;
+            heap[0] = heap[heapSize];
+            candidateSiftDown(heap, heapSize, 0);
+
+            const char *last = phnumBuilderLast(&result);
+
+            if ((last == NULL || compareJoined(last, "", top.prefix, top.suffix) != 0)
+                && !phnumBuilderAppend(&result, top.prefix, strlen(top.prefix), top.suffix, strlen(top.suffix))) {
+                phnumBuilderFree(&result);
+                free(heap);
+                return NULL;
+            }
+        }
+    }
+
+    free(heap);
+
+    return phnumBuilderFinish(&result);
+}
+
+struct PhoneNumbers const * phfwdReverse(struct PhoneForward *pf, char const *num) {
+
+    if(checkIfNumber(num) == false)
+        return emptyPhnum();
+
+    size_t length = strlen(num);
+    size_t heapCapacity;
+    struct ReverseCandidate *heap = candidateHeapNew(num, length, &heapCapacity);
+
+    if (heap == NULL)
+        return NULL;
+
+    size_t heapSize = 1;
+    bool endOfBranch = false;
+    bool locked = false;
+    struct ReaderSlot *slot = readBegin(pf);
+    struct ForwardNode *tmp = LOAD_ACQUIRE(pf->root);
+    size_t i = 0;
+
+    while (i < length && !endOfBranch) {
+
+        struct ForwardNode *child = readChild(tmp, charDigitToInt(num[i]));
+
+        if (child == NULL || !labelFullyMatches(child, num, i, length))
+            endOfBranch = true;
+
+        else {
+            tmp = child;
+            i += child->labelLength;
+
+            struct ReverseList *list = LOAD_ACQUIRE(tmp->fwdFrom);
+
+            /* Wszystkie węzły na ścieżce należą do pasma pierwszej cyfry numeru. Lista
+             * odłączona od węzła w międzyczasie jest pusta, więc sortowanie jej nic nie zmienia. */
+            if (list != NULL && !LOAD_ACQUIRE(list->sorted)) {
+
+                if (!locked) {
+                    lockStripes(pf, stripeOf(num));
+                    locked = true;
+                }
+
+                reverseListSort(list);
+            }
+
+            struct ReverseEntry *first = (list == NULL ? NULL : LOAD_ACQUIRE(list->head));
+
+            if (first != NULL)
+                candidatePush(&heap, &heapSize, &heapCapacity, (struct ReverseCandidate) {first->number, num + i, first, false});
+        }
+    }
+
+    if (locked)
+        unlockStripes(pf, stripeOf(num));
+
+    /* Listy są scalane bezpośrednio, więc odczyt trwa do końca scalania. */
+    struct PhoneNumbers *result = reverseMerge(heap, heapSize, heapCapacity, reverseEntryNext, NULL);
+
+    readEnd(slot);
+
+    return result;
+}
+
+char const * phnumGet(struct PhoneNumbers const *pnum, size_t idx) {
+
+    if (pnum == NULL || idx >= pnum->count)
+        return NULL;
+
+    return phnumDigits(pnum) + pnum->offsets[idx];
+}
+
+size_t phnumCopyLines(struct PhoneNumbers const *pnum, char *buf, size_t cap) {
+
+    if (pnum == NULL || pnum->count == 0)
+        return 0;
+
+    const char *digits = phnumDigits(pnum);
+    size_t last = pnum->offsets[pnum->count - 1];
+    size_t length = last + strlen(digits + last) + 1;
+
+    if (length <= cap) {
+
+        /* Numery leżą jeden za drugim, więc wystarczy zamienić kończące je znaki '\0'. */
+        memcpy(buf, digits, length);
+
+        for (size_t i = 1; i < pnum->count; i++)
+            buf[pnum->offsets[i] - 1] = '\n';
+
+        buf[length - 1] = '\n';
+    }
+
+    return length;
+}
+
+/** @brief Upraszcza napis do tablicy mówiącej jakie cyfry zawiera
+ * @param[in] set - wskaźnik na upraszczany napis;
+ * @param[in,out] simplifiedSet - tablica, która będzie mówić jakie cyfry zawiera napis.
+ */
+static void getSimplifiedSet(char const *set, bool *simplifiedSet) {
+
+    int i = 0;
+    int numberOfUniqueDigits = 0;
+    while (set[i] != '\0' && numberOfUniqueDigits < NUMBER_OF_DIGITS) {
+
+        if (isDigit(set[i]) && simplifiedSet[charDigitToInt(set[i])] == false) {
+            simplifiedSet[charDigitToInt(set[i])] = true;
+            numberOfUniqueDigits++;
+        }
+
+        i++;
+    }
+}
+
+/** @brief Wykonuję operację potęgowania i zwraca wynik.
+ * @param[in] base - liczba podnoszona do potęgi;
+ * @param[in] exponent - potęga, do której podnosimy liczbę.
+ * @return Wynik potęgowania
+ */
+static size_t myPow(size_t base, size_t exponent) {
+
+    size_t result = 1;
+
+    while (exponent > 0) {
+
+        if (exponent & 1) {
+
+            result = (size_t) (result * base);
+            exponent--;
+        }
+
+        else {
+
+            exponent = exponent >> 1;
+            base = (size_t)(base * base);
+        }
+    }
+
+    return result;
+}
+
+/** @brief Sprawdza, czy etykieta węzła składa się tylko z cyfr z podanego zbioru.
+ * @param[in] node - wskaźnik na węzeł;
+ * @param[in] simplifiedSet - tablica mówiąca jakie cyfry są zawarte w zbiorze.
+ * @return Wartość @p true jeśli wszystkie cyfry etykiety należą do zbioru,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool labelInSet(struct ForwardNode *node, bool *simplifiedSet) {
+
+    const char *label = nodeLabel(node);
+
+    for (uint32_t i = 0; i < node->labelLength; i++) {
+
+        if (simplifiedSet[charDigitToInt(label[i])] == false)
+            return false;
+    }
+
+    return true;
+}
+
+/** @brief Wypełnia tablicę potęg używanych przy zliczaniu numerów nietrywialnych.
+ * Na pozycji @p depth zapisuje liczbę numerów długości @p len mających ustalony prefiks
+ * długości @p depth, czyli @p setSize do potęgi @p len - @p depth, dla głębokości
+ * od zera do mniejszej z liczb @p len i @ref POWER_TABLE_SIZE - 1.
+ * @param[out] powers - tablica o rozmiarze @ref POWER_TABLE_SIZE;
+ * @param[in] setSize - ilość unikalnych cyfr w zbiorze;
+ * @param[in] len - długość zliczanych numerów.
+ */
+static void fillPowerTable(size_t *powers, size_t setSize, size_t len) {
+
+    size_t deepest = (len < POWER_TABLE_SIZE - 1 ? len : POWER_TABLE_SIZE - 1);
+
+    powers[deepest] = myPow(setSize, len - deepest);
+
+    for (size_t depth = deepest; depth > 0; depth--)
+        powers[depth - 1] = (size_t)(powers[depth] * setSize);
+}
+
+/** @brief Wyznacza liczbę numerów długości @p len mających ustalony prefiks długości @p depth.
+ * @param[in] powers - tablica wypełniona przez @ref fillPowerTable;
+ * @param[in] setSize - ilość unikalnych cyfr w zbiorze;
+ * @param[in] len - długość zliczanych numerów;
+ * @param[in] depth - długość prefiksu, nie większa niż @p len.
+ * @return @p setSize do potęgi @p len - @p depth modulo dwa do potęgi liczba bitów typu size_t.
+ */
+static size_t powerAt(const size_t *powers, size_t setSize, size_t len, size_t depth) {
+
+    if (depth < POWER_TABLE_SIZE)
+        return powers[depth];
+
+    return myPow(setSize, len - depth);
+}
+
+/** @brief Parametry zliczania numerów nietrywialnych wspólne dla wszystkich przechodzonych poddrzew.
+ */
+struct CountQuery {
+
+    size_t len; /**< długość zliczanych numerów */
+    size_t setSize; /**< ilość unikalnych cyfr w zbiorze */
+    bool simplifiedSet[NUMBER_OF_DIGITS]; /**< tablica mówiąca jakie cyfry są zawarte w zbiorze */
+    unsigned digits; /**< maska bitowa cyfr zbioru */
+    size_t powers[POWER_TABLE_SIZE]; /**< tablica wypełniona przez @ref fillPowerTable */
+};
+
+/** @brief Zlicza numery nietrywialne w poddrzewie węzła.
+ * Przechodzi poddrzewo iteracyjnie, schodząc tylko do węzłów, których etykiety składają się
+ * z cyfr ze zbioru i w których poddrzewach są listy przekierowań na węzły, i nie schodząc
+ * poniżej węzłów, na które coś się przekierowuje.
+ * @param[in] query - wskaźnik na parametry zliczania;
+ * @param[in] top - wskaźnik na korzeń poddrzewa;
+ * @param[in] depth - długość prefiksu reprezentowanego przez korzeń poddrzewa.
+ * @return Liczba numerów nietrywialnych w poddrzewie modulo dwa do potęgi liczba bitów typu size_t.
+ */
+static size_t countNonTrivialFrom(const struct CountQuery *query, struct ForwardNode *top, size_t depth) {
+
+    size_t len = query->len;
+    size_t setSize = query->setSize;
+    const size_t *powers = query->powers;
+    bool *simplifiedSet = (bool *) query->simplifiedSet;
+    struct TreeWalk walk;
+    size_t counter = 0;
+
+    walkStart(&walk, top, depth, query->digits, true);
+
+    while (true) {
+
+        struct ForwardNode *node = walk.node;
+        bool descend = false;
+
+        if (walk.depth <= len && labelInSet(node, simplifiedSet)) {
+
+            if (node->fwdFrom != NULL)
+                counter = (size_t)(counter + powerAt(powers, setSize, len, walk.depth));
+
+            else
+                descend = true;
+        }
+
+        if (descend && walkChildAfter(&walk, -1))
+            continue;
+
+        int digit = walkUp(&walk);
+
+        while (digit >= 0 && !walkChildAfter(&walk, digit))
+            digit = walkUp(&walk);
+
+        if (digit < 0)
+            break;
+    }
+
+    return counter;
+}
+
+/** @brief Poddrzewo do przejścia przez równoległe zliczanie.
+ */
+struct CountTask {
+
+    struct ForwardNode *node; /**< wskaźnik na korzeń poddrzewa */
+    size_t depth; /**< długość prefiksu reprezentowanego przez korzeń poddrzewa */
+};
+
+/** @brief Wątek równoległego zliczania numerów nietrywialnych.
+ * Wątek wykonuje zadania ze swojego przedziału, biorąc je od początku. Gdy przedział się
+ * wyczerpie, zabiera połowę zadań z końca przedziału innego wątku.
+ */
+struct CountWorker {
+
+    pthread_mutex_t lock; /**< blokada chroniąca przedział zadań */
+    size_t begin; /**< indeks pierwszego niewykonanego zadania z przedziału */
+    size_t end; /**< indeks za ostatnim zadaniem z przedziału */
+    size_t counter; /**< suma wyników wykonanych zadań modulo dwa do potęgi liczba bitów typu size_t */
+    size_t index; /**< pozycja wątku w tablicy wątków */
+    struct CountJob *job; /**< wskaźnik na zliczanie, w którym bierze udział wątek */
+};
+
+/** @brief Równoległe zliczanie numerów nietrywialnych zlecane wykonawcy.
+ * Każde wywołanie zadania przez wykonawcę zajmuje kolejne miejsce w tablicy wątków.
+ */
+struct CountJob {
+
+    const struct CountQuery *query; /**< wskaźnik na parametry zliczania */
+    const struct CountTask *tasks; /**< tablica zadań */
+    struct CountWorker *workers; /**< tablica wątków */
+    size_t workerCount; /**< liczba wątków */
+    pthread_mutex_t lock; /**< blokada chroniąca licznik @p joined */
+    size_t joined; /**< liczba zajętych miejsc w tablicy wątków */
+};
+
+/** @brief Zabiera połowę zadań z końca przedziału innego wątku.
+ * @param[in,out] self - wskaźnik na wątek, którego przedział jest pusty.
+ * @return Wartość @p true jeśli wątek dostał nowy przedział zadań,
+ *         wartość @p false jeśli wszystkie przedziały są puste.
+ */
+static bool countSteal(struct CountWorker *self) {
+
+    struct CountJob *job = self->job;
+
+    for (size_t i = 1; i < job->workerCount; i++) {
+
+        struct CountWorker *victim = &(job->workers[(self->index + i) % job->workerCount]);
+
+        pthread_mutex_lock(&(victim->lock));
+
+        size_t remaining = victim->end - victim->begin;
+        size_t stolen = (remaining + 1) / 2;
+        size_t end = victim->end;
+        victim->end -= stolen;
+
+        pthread_mutex_unlock(&(victim->lock));
+
+        if (stolen > 0) {
+
+            pthread_mutex_lock(&(self->lock));
+            self->begin = end - stolen;
+            self->end = end;
+            pthread_mutex_unlock(&(self->lock));
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** @brief Zadanie równoległego zliczania wykonywane przez wykonawcę.
+ * Zajmuje wolne miejsce w tablicy wątków, wykonuje zadania ze swojego przedziału i zadania
+ * zabrane innym wątkom, aż wszystkie przedziały będą puste. Zadania nie powstają w trakcie
+ * zliczania, więc wywołanie, które nie znalazło pracy, może się zakończyć. Przedziały miejsc,
+ * których nie zajęło żadne wywołanie, zostaną zabrane przez pozostałe.
+ * @param[in,out] argument - wskaźnik na zliczanie (@ref CountJob).
+ */
+static void countJobRun(void *argument) {
+
+    struct CountJob *job = argument;
+
+    pthread_mutex_lock(&(job->lock));
+    size_t index = job->joined;
+    if (index < job->workerCount)
+        job->joined++;
+    pthread_mutex_unlock(&(job->lock));
+
+    if (index == job->workerCount)
+        return;
+
+    struct CountWorker *self = &(job->workers[index]);
+
+    do {
+
+        while (true) {
+
+            pthread_mutex_lock(&(self->lock));
+
+            if (self->begin == self->end) {
+                pthread_mutex_unlock(&(self->lock));
+                break;
+            }
+
+            const struct CountTask *task = &(job->tasks[self->begin]);
+            self->begin++;
+
+            pthread_mutex_unlock(&(self->lock));
+
+            self->counter = (size_t)(self->counter + countNonTrivialFrom(job->query, task->node, task->depth));
+        }
+
+    } while (countSteal(self));
+}
+
+/** @brief Dzieli zliczanie na poddrzewa do przejścia równolegle.
+ * Schodzi od korzenia poziomami drzewa, dopóki zadań jest mniej niż
+ * @ref COUNT_TASKS_PER_THREAD na wątek, ale nie głębiej niż @ref COUNT_MAX_SPLIT_DEPTH węzłów.
+ * Węzły nad wybranym poziomem, na które coś się przekierowuje, są zliczane od razu.
+ * @param[in] query - wskaźnik na parametry zliczania;
+ * @param[in] root - wskaźnik na korzeń drzewa;
+ * @param[in] threads - liczba wątków;
+ * @param[out] tasks - adres wskaźnika, pod którym zostanie zapisana tablica zadań;
+ * @param[out] taskCount - wskaźnik na miejsce na liczbę zadań;
+ * @param[out] counter - wskaźnik na miejsce na liczbę numerów zliczonych od razu.
+ * @return Wartość @p true jeśli podział się powiódł,
+ *         wartość @p false, gdy nie udało się zaalokować pamięci.
+ */
+static bool countSplit(const struct CountQuery *query, struct ForwardNode *root, size_t threads,
+                       struct CountTask **tasks, size_t *taskCount, size_t *counter) {
+
+    struct CountTask *level = NULL;
+    struct CountTask *nextLevel = NULL;
+    size_t levelCapacity = 0;
+    size_t nextCapacity = 0;
+    size_t levelCount = 0;
+
+    (*counter) = 0;
+
+    if (root->fwdFrom != NULL)
+        (*counter) = query->powers[0];
+
+    else {
+
+        if (!reserveArray((void **) &level, &levelCapacity, 1, sizeof(struct CountTask)))
+            return false;
+
+        level[0].node = root;
+        level[0].depth = 0;
+        levelCount = 1;
+    }
+
+    for (size_t split = 0; split < COUNT_MAX_SPLIT_DEPTH && levelCount > 0
+                           && levelCount < threads * COUNT_TASKS_PER_THREAD; split++) {
+
+        size_t nextCount = 0;
+
+        for (size_t i = 0; i < levelCount; i++) {
+
+            struct ForwardNode *node = level[i].node;
+            unsigned candidates = node->reverseMask & query->digits;
+
+            while (candidates != 0) {
+
+                struct ForwardNode *child = getChild(node, countBits((candidates & (~candidates + 1)) - 1));
+                size_t depth = level[i].depth + child->labelLength;
+
+                candidates &= candidates - 1;
+
+                if (depth > query->len || !labelInSet(child, (bool *) query->simplifiedSet))
+                    continue;
+
+                if (child->fwdFrom != NULL) {
+                    (*counter) = (size_t)((*counter) + powerAt(query->powers, query->setSize, query->len, depth));
+                    continue;
+                }
+
+                if (!reserveArray((void **) &nextLevel, &nextCapacity, nextCount + 1, sizeof(struct CountTask))) {
+                    free(level);
+                    free(nextLevel);
+                    return false;
+                }
+
+                nextLevel[nextCount].node = child;
+                nextLevel[nextCount].depth = depth;
+                nextCount++;
+            }
+        }
+
+        struct CountTask *swapped = level;
+        size_t swappedCapacity = levelCapacity;
+        level = nextLevel;
+        levelCapacity = nextCapacity;
+        levelCount = nextCount;
+        nextLevel = swapped;
+        nextCapacity = swappedCapacity;
+    }
+
+    free(nextLevel);
+
+    (*tasks) = level;
+    (*taskCount) = levelCount;
+
+    return true;
+}
+
+/** @brief Zlicza numery nietrywialne na wątkach wykonawcy.
+ * Wątków jest co najwyżej tyle, ile zadań. Zadania są rozdzielane między nie po równo
+ * w ciągłych przedziałach.
+ * @param[in] query - wskaźnik na parametry zliczania;
+ * @param[in] tasks - tablica zadań;
+ * @param[in] taskCount - liczba zadań;
+ * @param[in] executor - wskaźnik na wykonawcę zadań;
+ * @param[in] threads - liczba wątków, co najmniej dwa.
+ * @return Suma wyników zadań modulo dwa do potęgi liczba bitów typu size_t.
+ *         Gdy nie udało się zaalokować pamięci, zadania są wykonywane na wątku wywołującym.
+ */
+static size_t countParallel(const struct CountQuery *query, const struct CountTask *tasks, size_t taskCount,
+                            struct ParallelExecutor const *executor, size_t threads) {
+
+    struct CountJob job;
+    size_t counter = 0;
+
+    if (threads > taskCount)
+        threads = taskCount;
+
+    job.query = query;
+    job.tasks = tasks;
+    job.workerCount = threads;
+    job.joined = 0;
+    job.workers = malloc(sizeof(struct CountWorker) * threads);
+
+    if (job.workers == NULL) {
+
+        for (size_t i = 0; i < taskCount; i++)
+            counter = (size_t)(counter + countNonTrivialFrom(query, tasks[i].node, tasks[i].depth));
+
+        return counter;
+    }
+
+    pthread_mutex_init(&(job.lock), NULL);
+
+    for (size_t i = 0; i < threads; i++) {
+
+        struct CountWorker *worker = &(job.workers[i]);
+
+        pthread_mutex_init(&(worker->lock), NULL);
+        worker->begin = taskCount * i / threads;
+        worker->end = taskCount * (i + 1) / threads;
+        worker->counter = 0;
+        worker->index = i;
+        worker->job = &job;
+    }
+
+    executor->run(executor->context, countJobRun, &job, threads);
+
+    for (size_t i = 0; i < threads; i++) {
+
+        struct CountWorker *worker = &(job.workers[i]);
+
+        counter = (size_t)(counter + worker->counter);
+        pthread_mutex_destroy(&(worker->lock));
+    }
+
+    pthread_mutex_destroy(&(job.lock));
+    free(job.workers);
+
+    return counter;
+}
+
+/** @brief Wyznacza miejsce w pamięci wyników zliczania dla podanego zbioru i długości.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] digits - maska bitowa cyfr zbioru;
+ * @param[in] len - długość zliczanych numerów.
+ * @return Wskaźnik na miejsce, w którym wynik jest lub zostanie zapamiętany.
+ */
+static struct CountCacheEntry *countCacheSlot(struct PhoneForward *pf, unsigned digits, size_t len) {
+
+    size_t hash = (size_t)(digits * COUNT_CACHE_HASH_MULTIPLIER + len);
+
+    return &(pf->countCache[hash % COUNT_CACHE_SIZE]);
+}
+
+/** @brief Wyznacza zbiór cyfr napisu na potrzeby zliczania numerów nietrywialnych.
+ * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
+ * @param[out] simplifiedSet - tablica, która będzie mówić jakie cyfry zawiera napis;
+ * @param[out] digits - wskaźnik na miejsce, w które zostanie zapisana maska bitowa cyfr napisu.
+ * @return Ilość unikalnych cyfr w napisie.
+ */
+static size_t digitSetOf(char const *set, bool *simplifiedSet, unsigned *digits) {
+
+    size_t setSize = 0;
+
+    memset(simplifiedSet, 0, NUMBER_OF_DIGITS);
+
+    getSimplifiedSet(set, simplifiedSet);
+
+    (*digits) = 0;
+
+    for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
+
+        if (simplifiedSet[i] == true) {
+            setSize++;
+            (*digits) |= 1u << i;
+        }
+    }
+
+    return setSize;
+}
+
+/** @brief Oblicza liczbę nietrywialnych numerów, przechodząc drzewo na podanej liczbie wątków.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
+ * @param[in] len - długość wyznaczanych numerów;
+ * @param[in] executor - wskaźnik na wykonawcę zadań lub NULL, jeśli zliczanie ma się odbyć
+ *                       na wątkach puli bazy;
+ * @param[in] threads - liczba wątków; przy jednym wątku drzewo jest przechodzone bez podziału.
+ * @return Wynik jak dla @ref phfwdNonTrivialCount.
+ */
+static size_t nonTrivialCount(struct PhoneForward *pf, char const *set, size_t len,
+                              struct ParallelExecutor const *executor, size_t threads) {
+
+    if (pf == NULL || set == NULL || len == 0 || set[0] == '\0')
+        return 0;
+
+    struct CountQuery query;
+    query.len = len;
+    query.setSize = digitSetOf(set, query.simplifiedSet, &(query.digits));
+
+    if (query.setSize == 0)
+        return 0;
+
+    struct CountCacheEntry *slot = countCacheSlot(pf, query.digits, len);
+
+    if (slot->generation == pf->generation && slot->digits == query.digits && slot->len == len)
+        return slot->result;
+
+    fillPowerTable(query.powers, query.setSize, len);
+
+    struct CountTask *tasks;
+    size_t taskCount;
+    size_t counter;
+
+    if (threads <= 1 || !countSplit(&query, pf->root, threads, &tasks, &taskCount, &counter))
+        slot->result = countNonTrivialFrom(&query, pf->root, 0);
+
+    else {
+
+        struct ParallelExecutor poolExecutor = {workerPoolRun, &(pf->countPool)};
+
+        if (taskCount > 1)
+            counter = (size_t)(counter + countParallel(&query, tasks, taskCount,
+                                                       (executor != NULL ? executor : &poolExecutor), threads));
+
+        else if (taskCount == 1)
+            counter = (size_t)(counter + countNonTrivialFrom(&query, tasks[0].node, tasks[0].depth));
+
+        free(tasks);
+        slot->result = counter;
+    }
+
+    slot->generation = pf->generation;
+    slot->digits = (uint16_t) query.digits;
+    slot->len = len;
+
+    return slot->result;
+}
+
+size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len) {
+
+    return nonTrivialCount(pf, set, len, NULL, 1);
+}
+
+size_t phfwdNonTrivialCountParallel(struct PhoneForward *pf, char const *set, size_t len, size_t threads) {
+
+    return nonTrivialCount(pf, set, len, NULL, threads);
+}
+
+size_t phfwdNonTrivialCountOn(struct PhoneForward *pf, char const *set, size_t len, struct ParallelExecutor const *executor, size_t threads) {
+
+    return nonTrivialCount(pf, set, len, executor, (executor == NULL ? 1 : threads));
+}
+
+/** @brief Adres obiektu bazy wraz z przypisaną mu wartością.
+ * Posortowana według adresów tablica takich par służy za odwzorowanie obiektów bazy
+ * (numerów z puli, węzłów) na ich pozycje w zapisie bazy.
+ */
+struct AddressIndex {
+
+    const void *address; /**< adres obiektu */
+    uint32_t value; /**< wartość przypisana obiektowi */
+};
+
+/** @brief Porównuje pary według adresów.
+ * @param[in] a - wskaźnik na pierwszą parę;
+ * @param[in] b - wskaźnik na drugą parę.
+ * @return Liczba ujemna, zero lub liczba dodatnia, jak w funkcji @p qsort.
+ */
+static int compareAddresses(const void *a, const void *b) {
+
+    uintptr_t first = (uintptr_t) ((const struct AddressIndex *) a)->address;
+    uintptr_t second = (uintptr_t) ((const struct AddressIndex *) b)->address;
+
+    return (first > second) - (first < second);
+}
+
+/** @brief Wyznacza wartość przypisaną obiektowi.
+ * @param[in] index - tablica par posortowana według adresów;
+ * @param[in] count - liczba par w tablicy;
+ * @param[in] address - adres obiektu występującego w tablicy lub NULL.
+ * @return Wartość przypisana obiektowi lub @ref FROZEN_NONE, jeśli @p address ma wartość NULL.
+ */
+static uint32_t addressIndexFind(const struct AddressIndex *index, size_t count, const void *address) {
+
+    if (address == NULL)
+        return FROZEN_NONE;
+
+    struct AddressIndex key = {address, 0};
+    const struct AddressIndex *found = bsearch(&key, index, count, sizeof(struct AddressIndex), compareAddresses);
+
+    return found->value;
+}
+
+/** @brief Układa węzły bazy w kolejności przechodzenia drzewa wszerz.
+ * Przy okazji sortuje listy przekierowań na węzły i zlicza miejsce potrzebne na migawkę.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[out] nodeCount - wskaźnik na miejsce na liczbę węzłów;
+ * @param[out] entryCount - wskaźnik na miejsce na liczbę elementów list razem z wartościami kończącymi;
+ * @param[out] labelsSize - wskaźnik na miejsce na łączną długość etykiet.
+ * @return Tablica węzłów, którą należy zwolnić, lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct ForwardNode **breadthFirstOrder(struct PhoneForward *pf, size_t *nodeCount, size_t *entryCount,
+                                              size_t *labelsSize) {
+
+    size_t capacity = STARTING_RESULT_COUNT;
+    struct ForwardNode **queue = malloc(sizeof(struct ForwardNode *) * capacity);
+
+    if (queue == NULL)
+        return NULL;
+
+    queue[0] = pf->root;
+    (*nodeCount) = 1;
+    (*entryCount) = 0;
+    (*labelsSize) = 0;
+
+    for (size_t i = 0; i < (*nodeCount); i++) {
+
+        struct ForwardNode *node = queue[i];
+        size_t children = countBits(node->occupancy);
+
+        if ((*nodeCount) + children > capacity) {
+
+            capacity *= 2;
+
+            struct ForwardNode **resized = realloc(queue, sizeof(struct ForwardNode *) * capacity);
+
+            if (resized == NULL) {
+                free(queue);
+                return NULL;
+            }
+
+            queue = resized;
+        }
+
+        memcpy(queue + (*nodeCount), node->children, sizeof(struct ForwardNode *) * children);
+        (*nodeCount) += children;
+        (*labelsSize) += node->labelLength;
+
+        if (node->fwdFrom != NULL) {
+
+            reverseListSort(node->fwdFrom);
+
+            for (struct ReverseEntry *entry = node->fwdFrom->head; entry != NULL; entry = entry->next)
+                (*entryCount)++;
+
+            (*entryCount)++;
+        }
+    }
+
+    return queue;
+}
+
+/** @brief Zwraca tablicę węzłów migawki.
+ * @param[in] ff - wskaźnik na migawkę.
+ * @return Wskaźnik na korzeń, czyli pierwszy węzeł tablicy.
+ */
+static const struct FrozenNode *frozenNodes(const struct FrozenForward *ff) {
+
+    return (const struct FrozenNode *) ((const char *) ff + ff->nodesOffset);
+}
+
+/** @brief Zwraca tablicę elementów list przekierowań na węzły migawki.
+ * @param[in] ff - wskaźnik na migawkę.
+ * @return Wskaźnik na pierwszy element tablicy.
+ */
+static const uint32_t *frozenEntries(const struct FrozenForward *ff) {
+
+    return (const uint32_t *) ((const char *) ff + ff->entriesOffset);
+}
+
+/** @brief Zwraca obszar napisów migawki.
+ * @param[in] ff - wskaźnik na migawkę.
+ * @return Wskaźnik na pierwszy znak obszaru napisów.
+ */
+static const char *frozenStrings(const struct FrozenForward *ff) {
+
+    return (const char *) ff + ff->stringsOffset;
+}
+
+/** @brief Wypełnia węzły i listy przekierowań na węzły migawki.
+ * Listy bazy są posortowane, więc listy migawki są przepisywane z nich w tej samej kolejności.
+ * @param[in,out] ff - wskaźnik na migawkę z wypełnionym nagłówkiem i numerami;
+ * @param[in] queue - węzły bazy w kolejności przechodzenia drzewa wszerz;
+ * @param[in] strings - numery bazy posortowane według adresów;
+ * @param[in] stringCount - liczba numerów bazy;
+ * @param[in] labelsStart - pozycja pierwszej etykiety w obszarze napisów.
+ */
+static void frozenFill(struct FrozenForward *ff, struct ForwardNode **queue, const struct AddressIndex *strings,
+                       size_t stringCount, size_t labelsStart) {
+
+    struct FrozenNode *nodes = (struct FrozenNode *) frozenNodes(ff);
+    uint32_t *entries = (uint32_t *) frozenEntries(ff);
+    char *text = (char *) frozenStrings(ff);
+    size_t labelCursor = labelsStart;
+    size_t entryCursor = 0;
+    size_t childCursor = 1;
+
+    nodes[0].parent = FROZEN_NONE;
+
+    for (size_t i = 0; i < ff->nodeCount; i++) {
+
+        struct ForwardNode *node = queue[i];
+        struct FrozenNode *frozen = &(nodes[i]);
+        size_t children = countBits(node->occupancy);
+
+        frozen->firstChild = (uint32_t) childCursor;
+
+        for (size_t j = 0; j < children; j++)
+            nodes[childCursor + j].parent = (uint32_t) i;
+
+        childCursor += children;
+
+        frozen->label = (uint32_t) labelCursor;
+        frozen->labelLength = node->labelLength;
+        memcpy(text + labelCursor, nodeLabel(node), node->labelLength);
+        labelCursor += node->labelLength;
+
+        frozen->fwdTo = addressIndexFind(strings, stringCount, node->fwdTo);
+        frozen->fwdFrom = FROZEN_NONE;
+
+        if (node->fwdFrom != NULL) {
+
+            frozen->fwdFrom = (uint32_t) entryCursor;
+
+            for (struct ReverseEntry *entry = node->fwdFrom->head; entry != NULL; entry = entry->next)
+                entries[entryCursor++] = addressIndexFind(strings, stringCount, entry->number);
+
+            entries[entryCursor++] = FROZEN_NONE;
+        }
+
+        frozen->occupancy = node->occupancy;
+        frozen->reverseMask = node->reverseMask;
+    }
+}
+
+struct FrozenForward * phfwdFreeze(struct PhoneForward *pf) {
+
+    if (pf == NULL)
+        return NULL;
+
+    size_t nodeCount, entryCount, labelsSize;
+    struct ForwardNode **queue = breadthFirstOrder(pf, &nodeCount, &entryCount, &labelsSize);
+
+    if (queue == NULL)
+        return NULL;
+
+    size_t stringCount = pf->numbers.count;
+    struct AddressIndex *strings = malloc(sizeof(struct AddressIndex) * (stringCount + 1));
+
+    if (strings == NULL) {
+        free(queue);
+        return NULL;
+    }
+
+    size_t numbersSize = 0;
+    size_t k = 0;
+
+    for (size_t i = 0; i < pf->numbers.bucketCount; i++) {
+
+        for (struct PooledNumber *entry = pf->numbers.buckets[i]; entry != NULL; entry = entry->next) {
+            strings[k++].address = entry->digits;
+            numbersSize += entry->length + 1;
+        }
+    }
+
+    qsort(strings, stringCount, sizeof(struct AddressIndex), compareAddresses);
+
+    size_t stringsSize = numbersSize + labelsSize + 1;
+    size_t nodesOffset = sizeof(struct FrozenForward);
+    size_t entriesOffset = nodesOffset + sizeof(struct FrozenNode) * nodeCount;
+    size_t stringsOffset = entriesOffset + sizeof(uint32_t) * entryCount;
+    struct FrozenForward *ff = NULL;
+
+    if (nodeCount < FROZEN_NONE && entryCount < FROZEN_NONE && stringsSize < FROZEN_NONE)
+        ff = malloc(stringsOffset + stringsSize);
+
+    if (ff != NULL) {
+
+        ff->magic = FROZEN_MAGIC;
+        ff->version = FROZEN_VERSION;
+        ff->size = stringsOffset + stringsSize;
+        ff->nodesOffset = nodesOffset;
+        ff->entriesOffset = entriesOffset;
+        ff->stringsOffset = stringsOffset;
+        ff->nodeCount = (uint32_t) nodeCount;
+        ff->entryCount = (uint32_t) entryCount;
+        ff->stringsSize = (uint32_t) stringsSize;
+        ff->reserved = 0;
+
+        char *text = (char *) frozenStrings(ff);
+        size_t cursor = 0;
+
+        for (size_t i = 0; i < stringCount; i++) {
+
+            size_t length = numberPoolLength(strings[i].address);
+
+            strings[i].value = (uint32_t) cursor;
+            memcpy(text + cursor, strings[i].address, length + 1);
+            cursor += length + 1;
+        }
+
+        text[stringsSize - 1] = '\0';
+
+        frozenFill(ff, queue, strings, stringCount, cursor);
+    }
+
+    free(strings);
+    free(queue);
+
+    return ff;
+}
+
+void phfwdFrozenDelete(struct FrozenForward const *ff) {
+
+    free((void *) ff);
+}
+
+/** @brief Wyznacza syna węzła migawki dla podanej cyfry.
+ * @param[in] ff - wskaźnik na migawkę;
+ * @param[in] node - wskaźnik na węzeł migawki;
+ * @param[in] digit - cyfra syna.
+ * @return Wskaźnik na syna lub NULL, jeśli węzeł nie ma syna dla tej cyfry.
+ */
+static const struct FrozenNode *frozenChild(const struct FrozenForward *ff, const struct FrozenNode *node, int digit) {
+
+    if ((node->occupancy & (1u << digit)) == 0)
+        return NULL;
+
+    return frozenNodes(ff) + node->firstChild + countBits(node->occupancy & ((1u << digit) - 1));
+}
+
+/** @brief Sprawdza, czy cała etykieta węzła migawki zgadza się z numerem od podanej pozycji.
+ * @param[in] ff - wskaźnik na migawkę;
+ * @param[in] node - wskaźnik na węzeł migawki;
+ * @param[in] num - wskaźnik na napis reprezentujący numer;
+ * @param[in] position - pozycja w numerze, od której porównujemy;
+ * @param[in] length - długość numeru.
+ * @return Wartość @p true jeśli etykieta mieści się w numerze i się z nim zgadza,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool frozenLabelMatches(const struct FrozenForward *ff, const struct FrozenNode *node, char const *num,
+                               size_t position, size_t length) {
+
+    return (node->labelLength <= length - position
+            && memcmp(frozenStrings(ff) + node->label, num + position, node->labelLength) == 0);
+}
+
+struct PhoneNumbers const * phfwdFrozenGet(struct FrozenForward const *ff, char const *num) {
+
+    if (checkIfNumber(num) == false)
+        return emptyPhnum();
+
+    size_t length = strlen(num);
+    const char *strings = frozenStrings(ff);
+    const struct FrozenNode *node = frozenNodes(ff);
+    uint32_t bestMatch = FROZEN_NONE;
+    size_t bestMatchLength = 0;
+    bool endOfBranch = false;
+    size_t i = 0;
+
+    while (i < length && !endOfBranch) {
+
+        const struct FrozenNode *child = frozenChild(ff, node, charDigitToInt(num[i]));
+
+        if (child == NULL || !frozenLabelMatches(ff, child, num, i, length))
+            endOfBranch = true;
+
+        else {
+
+            i += child->labelLength;
+
+            if (child->fwdTo != FROZEN_NONE) {
+                bestMatch = child->fwdTo;
+                bestMatchLength = i;
+            }
+
+            node = child;
+        }
+    }
+
+    if (bestMatch == FROZEN_NONE)
+        return phnumSingleNew(num, length, "", 0);
+
+    return phnumSingleNew(strings + bestMatch, strlen(strings + bestMatch), num + bestMatchLength, length - bestMatchLength);
+}
+
+/** @brief Przechodzi do następnego elementu listy przekierowań na węzeł migawki.
+ * @param[in] context - wskaźnik na obszar napisów migawki;
+ * @param[in,out] entry - adres wskaźnika na element listy.
+ * @return Wskaźnik na numer następnego elementu lub NULL, jeśli lista się skończyła.
+ */
+static const char *frozenEntryNext(const void *context, const void **entry) {
+
+    const uint32_t *next = (const uint32_t *) (*entry) + 1;
+
+    (*entry) = next;
+
+    return ((*next) == FROZEN_NONE ? NULL : (const char *) context + (*next));
+}
+
+struct PhoneNumbers const * phfwdFrozenReverse(struct FrozenForward const *ff, char const *num) {
+
+    if (checkIfNumber(num) == false)
+        return emptyPhnum();
+
+    size_t length = strlen(num);
+    const char *strings = frozenStrings(ff);
+    const uint32_t *entries = frozenEntries(ff);
+    const struct FrozenNode *node = frozenNodes(ff);
+    size_t heapCapacity;
+    struct ReverseCandidate *heap = candidateHeapNew(num, length, &heapCapacity);
+
+    if (heap == NULL)
         return NULL;
 
-    char *number = NULL;
-    const struct PhoneNumbers *list = pnum;
+    size_t heapSize = 1;
+    bool endOfBranch = false;
+    size_t i = 0;
+
+    while (i < length && !endOfBranch) {
+
+        const struct FrozenNode *child = frozenChild(ff, node, charDigitToInt(num[i]));
+
+        if (child == NULL || !frozenLabelMatches(ff, child, num, i, length))
+            endOfBranch = true;
+
+        else {
+
+            node = child;
+            i += child->labelLength;
+
+            if (node->fwdFrom != FROZEN_NONE) {
+                const uint32_t *first = entries + node->fwdFrom;
+                candidatePush(&heap, &heapSize, &heapCapacity, (struct ReverseCandidate) {strings + (*first), num + i, first, false});
+            }
+        }
+    }
+
+    return reverseMerge(heap, heapSize, heapCapacity, frozenEntryNext, strings);
+}
+
+/** @brief Sprawdza, czy napis składa się tylko z cyfr z podanego zbioru.
+ * @param[in] label - wskaźnik na napis;
+ * @param[in] labelLength - długość napisu;
+ * @param[in] simplifiedSet - tablica mówiąca jakie cyfry są zawarte w zbiorze.
+ * @return Wartość @p true jeśli wszystkie cyfry napisu należą do zbioru,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool frozenLabelInSet(const char *label, uint32_t labelLength, bool *simplifiedSet) {
+
+    for (uint32_t i = 0; i < labelLength; i++) {
+
+        if (simplifiedSet[charDigitToInt(label[i])] == false)
+            return false;
+    }
+
+    return true;
+}
+
+size_t phfwdFrozenNonTrivialCount(struct FrozenForward const *ff, char const *set, size_t len) {
+
+    if (ff == NULL || set == NULL || len == 0 || set[0] == '\0')
+        return 0;
+
+    bool simplifiedSet[NUMBER_OF_DIGITS];
+    unsigned digits;
+    size_t setSize = digitSetOf(set, simplifiedSet, &digits);
+
+    if (setSize == 0)
+        return 0;
+
+    size_t powers[POWER_TABLE_SIZE];
+    const struct FrozenNode *nodes = frozenNodes(ff);
+    const char *strings = frozenStrings(ff);
+    const struct FrozenNode *node = nodes;
+    size_t depth = 0;
+    size_t counter = 0;
+    bool entered = true;
+    int digit = -1;
+
+    fillPowerTable(powers, setSize, len);
 
-    for (size_t i = 0; i < idx && list != NULL; i++) {
-        list = list->next;
+    /* Przechodzenie jak w countNonTrivial: drogę powrotną wyznaczają indeksy ojców,
+     * a @p digit to cyfra syna, z którego wróciliśmy do bieżącego węzła. */
+    while (true) {
+
+        bool descend = !entered;
+
+        if (entered && depth <= len && frozenLabelInSet(strings + node->label, node->labelLength, simplifiedSet)) {
+
+            if (node->fwdFrom != FROZEN_NONE)
+                counter = (size_t)(counter + powerAt(powers, setSize, len, depth));
+
+            else
+                descend = true;
+        }
+
+        unsigned above = (digit < 0 ? ~0u : ~((2u << digit) - 1));
+        unsigned candidates = (descend ? node->reverseMask & digits & above : 0);
+
+        if (candidates != 0) {
+
+            int childDigit = countBits((candidates & (~candidates + 1)) - 1);
+
+            node = nodes + node->firstChild + countBits(node->occupancy & ((1u << childDigit) - 1));
+            depth += node->labelLength;
+            entered = true;
+            digit = -1;
+        }
+
+        else if (node->parent == FROZEN_NONE)
+            break;
+
+        else {
+
+            digit = charDigitToInt(strings[node->label]);
+            depth -= node->labelLength;
+            node = nodes + node->parent;
+            entered = false;
+        }
     }
 
-    if (list != NULL)
-        number = list->number;
+    return counter;
+}
+
+/** @brief Buforowany zapis do deskryptora pliku.
+ */
+struct StreamWriter {
 
-    return number;
+    int fd; /**< deskryptor pliku */
+    size_t used; /**< liczba bajtów w buforze */
+    bool failed; /**< czy zapis się nie powiódł */
+    unsigned char buffer[SAVE_BUFFER_SIZE]; /**< bufor */
+};
+
+/** @brief Zapisuje zawartość bufora do pliku.
+ * @param[in,out] writer - wskaźnik na stan zapisu.
+ */
+static void writerFlush(struct StreamWriter *writer) {
+
+    size_t done = 0;
+
+    while (!writer->failed && done < writer->used) {
+
+        ssize_t written = write(writer->fd, writer->buffer + done, writer->used - done);
+
+        if (written == 0 || (written < 0 && errno != EINTR))
+            writer->failed = true;
+
+        else if (written > 0)
+            done += (size_t) written;
+    }
+
+    writer->used = 0;
 }
 
-/** @brief Upraszcza napis do tablicy mówiącej jakie cyfry zawiera
- * @param[in] set - wskaźnik na upraszczany napis;
- * @param[in,out] simplifiedSet - tablica, która będzie mówić jakie cyfry zawiera napis.
+/** @brief Dopisuje bajty do zapisu.
+ * @param[in,out] writer - wskaźnik na stan zapisu;
+ * @param[in] data - wskaźnik na dopisywane bajty;
+ * @param[in] size - liczba dopisywanych bajtów.
  */
-static void getSimplifiedSet(char const *set, bool *simplifiedSet) {
+static void writerPut(struct StreamWriter *writer, const void *data, size_t size) {
 
-    int i = 0;
-    int numberOfUniqueDigits = 0;
-    while (set[i] != '\0' && numberOfUniqueDigits < NUMBER_OF_DIGITS) {
+    const unsigned char *bytes = data;
 
-        if (isDigit(set[i]) && simplifiedSet[charDigitToInt(set[i])] == false) {
-            simplifiedSet[charDigitToInt(set[i])] = true;
-            numberOfUniqueDigits++;
+    while (size > 0 && !writer->failed) {
+
+        if (writer->used == SAVE_BUFFER_SIZE)
+            writerFlush(writer);
+
+        size_t chunk = SAVE_BUFFER_SIZE - writer->used;
+
+        if (chunk > size)
+            chunk = size;
+
+        memcpy(writer->buffer + writer->used, bytes, chunk);
+        writer->used += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+/** @brief Dopisuje do zapisu liczbę w kodowaniu o zmiennej długości.
+ * Każdy bajt niesie siedem bitów liczby, od najmłodszych, a najstarszy bit bajtu
+ * mówi, czy liczba ma dalsze bajty.
+ * @param[in,out] writer - wskaźnik na stan zapisu;
+ * @param[in] value - dopisywana liczba.
+ */
+static void writerPutNumber(struct StreamWriter *writer, uint64_t value) {
+
+    unsigned char bytes[10];
+    size_t size = 0;
+
+    do {
+        bytes[size] = (unsigned char) (value & 0x7f);
+        value >>= 7;
+
+        if (value != 0)
+            bytes[size] |= 0x80;
+
+        size++;
+    } while (value != 0);
+
+    writerPut(writer, bytes, size);
+}
+
+/** @brief Buforowany odczyt z deskryptora pliku.
+ */
+struct StreamReader {
+
+    int fd; /**< deskryptor pliku */
+    size_t position; /**< pozycja następnego bajtu w buforze */
+    size_t filled; /**< liczba bajtów w buforze */
+    unsigned char buffer[SAVE_BUFFER_SIZE]; /**< bufor */
+};
+
+/** @brief Odczytuje bajty z pliku.
+ * @param[in,out] reader - wskaźnik na stan odczytu;
+ * @param[out] data - wskaźnik na miejsce na odczytane bajty;
+ * @param[in] size - liczba odczytywanych bajtów.
+ * @return Wartość @p true jeśli udało się odczytać wszystkie bajty,
+ *         wartość @p false, jeśli plik się skończył lub odczyt się nie powiódł.
+ */
+static bool readerGet(struct StreamReader *reader, void *data, size_t size) {
+
+    unsigned char *bytes = data;
+
+    while (size > 0) {
+
+        if (reader->position == reader->filled) {
+
+            ssize_t got = read(reader->fd, reader->buffer, SAVE_BUFFER_SIZE);
+
+            if (got == 0 || (got < 0 && errno != EINTR))
+                return false;
+
+            reader->position = 0;
+            reader->filled = (got < 0 ? 0 : (size_t) got);
+            continue;
         }
 
-        i++;
+        size_t chunk = reader->filled - reader->position;
+
+        if (chunk > size)
+            chunk = size;
+
+        memcpy(bytes, reader->buffer + reader->position, chunk);
+        reader->position += chunk;
+        bytes += chunk;
+        size -= chunk;
     }
+
+    return true;
 }
 
-/** @brief Wykonuję operację potęgowania i zwraca wynik.
- * @param[in] base - liczba podnoszona do potęgi;
- * @param[in] exponent - potęga, do której podnosimy liczbę.
- * @return Wynik potęgowania
+/** @brief Odczytuje liczbę zapisaną przez @ref writerPutNumber.
+ * @param[in,out] reader - wskaźnik na stan odczytu;
+ * @param[out] value - wskaźnik na miejsce na odczytaną liczbę.
+ * @return Wartość @p true jeśli udało się odczytać poprawnie zapisaną liczbę,
+ *         wartość @p false w przeciwnym razie.
  */
-static size_t myPow(size_t base, size_t exponent) {
+static bool readerGetNumber(struct StreamReader *reader, uint64_t *value) {
 
-    size_t result = 1;
+    unsigned char byte;
+    unsigned shift = 0;
 
-    while (exponent > 0) {
+    (*value) = 0;
 
-        if (exponent & 1) {
+    do {
+        if (shift > 63 || !readerGet(reader, &byte, 1))
+            return false;
 
-            result = (size_t) (result * base);
-            exponent--;
+        (*value) |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return true;
+}
+
+/** @brief Numeruje węzły, na które coś się przekierowuje, w kolejności przechodzenia drzewa w głąb.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[out] count - wskaźnik na miejsce na liczbę ponumerowanych węzłów.
+ * @return Tablica par (węzeł, numer) posortowana według adresów węzłów, którą należy
+ *         zwolnić, lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static struct AddressIndex *numberTargets(struct PhoneForward *pf, size_t *count) {
+
+    size_t capacity = STARTING_RESULT_COUNT;
+    struct AddressIndex *targets = malloc(sizeof(struct AddressIndex) * capacity);
+    struct TreeWalk walk;
+
+    if (targets == NULL)
+        return NULL;
+
+    (*count) = 0;
+    walkStart(&walk, pf->root, 0, ALL_DIGITS, true);
+
+    while (true) {
+
+        if (walk.node->fwdFrom != NULL) {
+
+            if ((*count) == capacity) {
+
+                capacity *= 2;
+
+                struct AddressIndex *resized = realloc(targets, sizeof(struct AddressIndex) * capacity);
+
+                if (resized == NULL) {
+                    free(targets);
+                    return NULL;
+                }
+
+                targets = resized;
+            }
+
+            targets[(*count)] = (struct AddressIndex) {walk.node, (uint32_t) (*count)};
+            (*count)++;
         }
 
-        else {
+        if (walkChildAfter(&walk, -1))
+            continue;
 
-            exponent = exponent >> 1;
-            base = (size_t)(base * base);
+        int digit = walkUp(&walk);
+
+        while (digit >= 0 && !walkChildAfter(&walk, digit))
+            digit = walkUp(&walk);
+
+        if (digit < 0)
+            break;
+    }
+
+    qsort(targets, (*count), sizeof(struct AddressIndex), compareAddresses);
+
+    return targets;
+}
+
+/** @brief Dopisuje do zapisu jeden węzeł.
+ * Zapis węzła to maska synów, znaczniki, długość i cyfry etykiety oraz,
+ * dla węzła przekierowanego, numer węzła docelowego.
+ * @param[in,out] writer - wskaźnik na stan zapisu;
+ * @param[in] node - wskaźnik na zapisywany węzeł;
+ * @param[in] targets - numeracja węzłów docelowych z @ref numberTargets;
+ * @param[in] targetCount - liczba węzłów docelowych.
+ */
+static void saveNode(struct StreamWriter *writer, struct ForwardNode *node, const struct AddressIndex *targets,
+                     size_t targetCount) {
+
+    uint8_t flags = (uint8_t) ((node->fwdTo != NULL ? SAVE_FLAG_FORWARD : 0) | (node->fwdFrom != NULL ? SAVE_FLAG_TARGET : 0));
+    uint16_t occupancy = node->occupancy;
+
+    /* Puści synowie korzenia nie są zapisywani; wczytanie bazy tworzy ich od nowa. */
+    if (node->parent == NULL) {
+
+        for (int digit = 0; digit < NUMBER_OF_DIGITS; digit++) {
+
+            struct ForwardNode *child = getChild(node, digit);
+
+            if (child != NULL && isNodeEmpty(child))
+                occupancy &= (uint16_t) ~(1u << digit);
         }
     }
 
-    return result;
+    writerPut(writer, &occupancy, sizeof(occupancy));
+    writerPut(writer, &flags, sizeof(flags));
+    writerPutNumber(writer, node->labelLength);
+    writerPut(writer, nodeLabel(node), node->labelLength);
+
+    if (node->fwdTo != NULL)
+        writerPutNumber(writer, addressIndexFind(targets, targetCount, node->fwdEntry->list->owner));
 }
 
-/** @brief Rekurencyjnie zlicza numery nietrywialne o podanej długości i zawierające tylko cyfry z podanego zbioru.
- * @param[in] pf - wskaźnik na obsługiwany węzeł;
- * @param[in] depth - aktualna głębokość w drzewie;
- * @param[in] len - długość zliczanych numerów;
- * @param[in] setSize - ilość unikalnych cyfr w zbiorze;
- * @param[in] simplifiedSet - tablica mówiąca jakie cyfry są zawarte w zbiorze;
- * @param[in,out] counter - licznik numerów nietrywialnych.
+bool phfwdSave(struct PhoneForward *pf, int fd) {
+
+    if (pf == NULL)
+        return false;
+
+    size_t targetCount;
+    struct AddressIndex *targets = numberTargets(pf, &targetCount);
+    struct StreamWriter *writer = malloc(sizeof(struct StreamWriter));
+
+    if (targets == NULL || writer == NULL) {
+        free(targets);
+        free(writer);
+        return false;
+    }
+
+    uint32_t header[2] = {SAVE_MAGIC, SAVE_VERSION};
+    struct TreeWalk walk;
+
+    writer->fd = fd;
+    writer->used = 0;
+    writer->failed = false;
+    writerPut(writer, header, sizeof(header));
+
+    walkStart(&walk, pf->root, 0, ALL_DIGITS, false);
+    saveNode(writer, walk.node, targets, targetCount);
+
+    while (true) {
+
+        if (!walkChildAfter(&walk, -1)) {
+
+            int digit = walkUp(&walk);
+
+            while (digit >= 0 && !walkChildAfter(&walk, digit))
+                digit = walkUp(&walk);
+
+            if (digit < 0)
+                break;
+        }
+
+        if (!isNodeEmpty(walk.node))
+            saveNode(writer, walk.node, targets, targetCount);
+    }
+
+    writerFlush(writer);
+
+    bool saved = !writer->failed;
+
+    free(writer);
+    free(targets);
+
+    return saved;
+}
+
+/** @brief Węzeł wczytywanej bazy, którego synowie nie zostali jeszcze wczytani.
  */
-static void countNonTrivialRec(struct PhoneForward *pf, size_t depth, size_t len, size_t setSize, bool *simplifiedSet, size_t *counter) {
+struct LoadFrame {
 
-    if (pf != NULL && depth <= len) {
+    struct ForwardNode *node; /**< wskaźnik na węzeł */
+    uint16_t remaining; /**< maska cyfr synów, którzy nie zostali jeszcze wczytani */
+    size_t pathStart; /**< długość prefiksu reprezentowanego przez ojca węzła */
+};
 
-        if (pf->fwdFrom != NULL)
-            (*counter) = (size_t)((*counter) + myPow(setSize, len - depth));
+/** @brief Węzeł wczytywanej bazy, który jest przekierowany.
+ */
+struct LoadedForward {
 
-        else {
+    struct ForwardNode *source; /**< wskaźnik na przekierowany węzeł */
+    const char *number; /**< wskaźnik na prefiks węzła w puli numerów bazy */
+    uint64_t target; /**< numer węzła docelowego */
+};
 
-            for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
+/** @brief Węzeł wczytywanej bazy, na który coś się przekierowuje.
+ */
+struct LoadedTarget {
 
-                if (simplifiedSet[i] == true)
-                    countNonTrivialRec(pf->children[i], depth + 1, len, setSize, simplifiedSet, counter);
-            }
+    struct ForwardNode *node; /**< wskaźnik na węzeł */
+    const char *number; /**< wskaźnik na prefiks węzła w puli numerów bazy */
+};
+
+/** @brief Stan wczytywania bazy.
+ */
+struct LoadState {
+
+    struct StreamReader reader; /**< stan odczytu pliku */
+    struct PhoneForward *pf; /**< wskaźnik na budowaną bazę */
+    char *path; /**< prefiks reprezentowany przez ostatnio wczytany węzeł */
+    size_t pathLength; /**< długość prefiksu */
+    size_t pathCapacity; /**< rozmiar tablicy na prefiks */
+    struct LoadFrame *frames; /**< stos węzłów, których synowie nie zostali jeszcze wczytani */
+    size_t frameCount; /**< liczba węzłów na stosie */
+    size_t frameCapacity; /**< rozmiar stosu */
+    struct LoadedForward *forwards; /**< przekierowane węzły w kolejności wczytania */
+    size_t forwardCount; /**< liczba przekierowanych węzłów */
+    size_t forwardCapacity; /**< rozmiar tablicy przekierowanych węzłów */
+    struct LoadedTarget *targets; /**< węzły docelowe w kolejności wczytania */
+    size_t targetCount; /**< liczba węzłów docelowych */
+    size_t targetCapacity; /**< rozmiar tablicy węzłów docelowych */
+};
+
+/** @brief Wczytuje jeden węzeł i podłącza go do ojca.
+ * Węzeł od razu dostaje tablicę synów o docelowym rozmiarze, więc nie jest później przenoszony.
+ * @param[in,out] state - wskaźnik na stan wczytywania;
+ * @param[in,out] parent - wskaźnik na ojca lub NULL dla korzenia;
+ * @param[in] digit - cyfra, pod którą węzeł jest zapisany u ojca.
+ * @return Wskaźnik na wczytany węzeł lub NULL, jeśli zapis jest niepoprawny
+ *         albo nie udało się zaalokować pamięci.
+ */
+static struct ForwardNode *loadNode(struct LoadState *state, struct ForwardNode *parent, int digit) {
+
+    uint16_t occupancy;
+    uint8_t flags;
+    uint64_t labelLength;
+
+    if (!readerGet(&(state->reader), &occupancy, sizeof(occupancy)) || !readerGet(&(state->reader), &flags, sizeof(flags))
+        || !readerGetNumber(&(state->reader), &labelLength))
+        return NULL;
+
+    int children = countBits(occupancy);
+
+    if ((occupancy & ~ALL_DIGITS) != 0 || (flags & ~(SAVE_FLAG_FORWARD | SAVE_FLAG_TARGET)) != 0)
+        return NULL;
+
+    /* Poza korzeniem nie ma węzłów pustych. */
+    if (parent == NULL ? (labelLength != 0 || flags != 0) : (labelLength == 0 || labelLength > MAX_LABEL_LENGTH
+                                                              || (flags == 0 && children == 0)))
+        return NULL;
+
+    if (!reserveArray((void **) &(state->path), &(state->pathCapacity), state->pathLength + labelLength + 1, 1)
+        || !readerGet(&(state->reader), state->path + state->pathLength, labelLength))
+        return NULL;
+
+    char *label = state->path + state->pathLength;
+
+    for (uint64_t i = 0; i < labelLength; i++) {
+
+        if (!isDigit(label[i]))
+            return NULL;
+    }
+
+    if (parent != NULL && charDigitToInt(label[0]) != digit)
+        return NULL;
+
+    struct Arena *arena = (parent == NULL ? &(state->pf->arena) : stripeArena(state->pf, state->path));
+    struct ForwardNode *node = nodeNew(arena, fittingCapacity(children), label, labelLength);
+
+    if (node == NULL)
+        return NULL;
+
+    node->occupancy = occupancy;
+    node->parent = parent;
+    state->pathLength += labelLength;
+
+    if (parent != NULL)
+        (*getChildSlot(parent, digit)) = node;
+
+    if (flags & SAVE_FLAG_TARGET) {
+
+        if (!reserveArray((void **) &(state->targets), &(state->targetCapacity), state->targetCount + 1,
+                          sizeof(struct LoadedTarget)))
+            return NULL;
+
+        const char *number = numberPoolAcquire(&(state->pf->numbers), state->path, state->pathLength);
+
+        if (number == NULL)
+            return NULL;
+
+        state->targets[state->targetCount++] = (struct LoadedTarget) {node, number};
+    }
+
+    if (flags & SAVE_FLAG_FORWARD) {
+
+        uint64_t target;
+
+        if (!readerGetNumber(&(state->reader), &target)
+            || !reserveArray((void **) &(state->forwards), &(state->forwardCapacity), state->forwardCount + 1,
+                             sizeof(struct LoadedForward)))
+            return NULL;
+
+        const char *number = numberPoolAcquire(&(state->pf->numbers), state->path, state->pathLength);
+
+        if (number == NULL)
+            return NULL;
+
+        state->forwards[state->forwardCount++] = (struct LoadedForward) {node, number, target};
+    }
+
+    return node;
+}
+
+/** @brief Wczytuje drzewo bazy w kolejności przechodzenia w głąb.
+ * Wczytany korzeń zastępuje korzeń nowej bazy razem z jego pustymi synami.
+ * @param[in,out] state - wskaźnik na stan wczytywania.
+ * @return Wartość @p true jeśli udało się wczytać drzewo,
+ *         wartość @p false, jeśli zapis jest niepoprawny lub nie udało się zaalokować pamięci.
+ */
+static bool loadTree(struct LoadState *state) {
+
+    struct Arena *arena = &(state->pf->arena);
+    struct ForwardNode *root = loadNode(state, NULL, -1);
+
+    if (root == NULL || !reserveArray((void **) &(state->frames), &(state->frameCapacity), 1, sizeof(struct LoadFrame)))
+        return false;
+
+    for (int digit = 0; digit < WRITER_STRIPES; digit++)
+        nodeFree(&(state->pf->stripes[digit].arena), getChild(state->pf->root, digit));
+
+    nodeFree(arena, state->pf->root);
+    state->pf->root = root;
+    state->frames[0] = (struct LoadFrame) {root, root->occupancy, 0};
+    state->frameCount = 1;
+
+    while (state->frameCount > 0) {
+
+        struct LoadFrame *frame = &(state->frames[state->frameCount - 1]);
+
+        if (frame->remaining == 0) {
+            state->pathLength = frame->pathStart;
+            state->frameCount--;
+            continue;
         }
+
+        int digit = countBits((frame->remaining & (~frame->remaining + 1)) - 1);
+        size_t pathStart = state->pathLength;
+        struct ForwardNode *parent = frame->node;
+
+        frame->remaining &= (uint16_t) ~(1u << digit);
+
+        struct ForwardNode *child = loadNode(state, parent, digit);
+
+        if (child == NULL || !reserveArray((void **) &(state->frames), &(state->frameCapacity), state->frameCount + 1,
+                                           sizeof(struct LoadFrame)))
+            return false;
+
+        state->frames[state->frameCount++] = (struct LoadFrame) {child, child->occupancy, pathStart};
     }
 
+    return true;
 }
 
-size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len) {
+/** @brief Odtwarza listy przekierowań na węzły wczytanej bazy.
+ * Przekierowane węzły są wczytywane w porządku leksykograficznym ich prefiksów,
+ * więc elementy dopisywane na koniec list tworzą od razu listy posortowane.
+ * @param[in,out] state - wskaźnik na stan wczytywania po wczytaniu drzewa.
+ * @return Wartość @p true jeśli udało się odtworzyć listy,
+ *         wartość @p false, jeśli zapis jest niepoprawny lub nie udało się zaalokować pamięci.
+ */
+static bool linkForwards(struct LoadState *state) {
 
-    if (pf == NULL || set == NULL || len == 0 || set[0] == '\0')
-        return 0;
+    struct PhoneForward *pf = state->pf;
 
-    bool simplifiedSet[NUMBER_OF_DIGITS];
+    for (size_t i = 0; i < state->forwardCount; i++) {
 
-    memset(simplifiedSet, 0, NUMBER_OF_DIGITS);
+        struct LoadedForward *forward = &(state->forwards[i]);
 
-    getSimplifiedSet(set, simplifiedSet);
+        if (forward->target >= state->targetCount || state->targets[forward->target].node == forward->source)
+            return false;
 
-    size_t setSize = 0;
+        struct LoadedTarget *target = &(state->targets[forward->target]);
+        struct Arena *arena = stripeArena(pf, target->number);
+        struct ReverseList *list = reverseListOf(arena, target->node);
+        struct ReverseEntry *entry = (list == NULL ? NULL : reverseEntryNew(arena, forward->number));
 
-    for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
+        if (entry == NULL)
+            return false;
 
-        if (simplifiedSet[i] == true)
-            setSize++;
+        reverseListAppend(list, entry);
+        numberPoolRetain(target->number);
+        forward->source->fwdTo = target->number;
+        forward->source->fwdEntry = entry;
     }
 
-    if (setSize == 0)
-        return 0;
+    for (size_t i = 0; i < state->targetCount; i++) {
 
-    size_t counter = 0;
+        if (state->targets[i].node->fwdFrom == NULL)
+            return false;
+
+        numberPoolRelease(&(pf->numbers), state->targets[i].number);
+    }
 
-    countNonTrivialRec(pf, 0, len, setSize, simplifiedSet, &counter);
+    return true;
+}
 
-    return counter;
+struct PhoneForward * phfwdLoad(int fd) {
+
+    struct LoadState *state = calloc(1, sizeof(struct LoadState));
+
+    if (state == NULL)
+        return NULL;
+
+    uint32_t header[2];
+
+    state->reader.fd = fd;
+    state->pf = phfwdNew();
+
+    bool loaded = (state->pf != NULL && readerGet(&(state->reader), header, sizeof(header))
+                   && header[0] == SAVE_MAGIC && header[1] == SAVE_VERSION
+                   && loadTree(state) && linkForwards(state) && rootComplete(state->pf));
+
+    struct PhoneForward *pf = state->pf;
+
+    if (!loaded) {
+        phfwdDelete(pf);
+        pf = NULL;
+    }
+
+    free(state->path);
+    free(state->frames);
+    free(state->forwards);
+    free(state->targets);
+    free(state);
+
+    return pf;
 }
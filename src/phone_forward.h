@@ -9,32 +9,222 @@
 #ifndef __PHONE_FORWARD_H__
 #define __PHONE_FORWARD_H__
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include "arena.h"
+#include "number_pool.h"
+#include "worker_pool.h"
 
-/** @brief Struktura przechowująca przekierowania numerów telefonów.
- * Struktura przechowuję przekierowania numerów w drzewie.
- * Każdy węzeł reprezentuję jeden prefiks i posiada dziesięciu synów.
- * Jeżeli syn nie jest NULL'em reprezentuję on ten sam prefiks przedłużony o liczbę
- * zależną od jego pozycji w tablicy synów.
+#define COUNT_CACHE_SIZE 16 /**< liczba zapamiętywanych wyników @ref phfwdNonTrivialCount */
+#define FROZEN_NONE UINT32_MAX /**< wartość pozycji i indeksów migawki oznaczająca brak */
+#define FROZEN_MAGIC 0x46574650u /**< wartość pola @p magic migawki, w pamięci bajty "PFWF" na maszynie little-endian */
+#define FROZEN_VERSION 2u /**< wersja układu bloku migawki */
+#define READER_SLOTS 128 /**< liczba miejsc dla wątków jednocześnie czytających bazę */
+#define CACHE_LINE_SIZE 64 /**< rozmiar linii pamięci podręcznej, na której leży jedno miejsce czytelnika */
+#define WRITER_STRIPES 12 /**< liczba pasm bazy, po jednym na każdą cyfrę, od której może zaczynać się numer */
+
+/** @brief Element listy prefiksów, które przekierowują się na węzeł.
+ * Węzeł, z którego jest przekierowanie, trzyma wskaźnik na ten element, a element
+ * zna swoją listę, więc usunięcie przekierowania nie wymaga szukania elementu.
+ */
+struct ReverseEntry {
+
+    struct ReverseEntry *next; /**< wskaźnik na następny element listy */
+    struct ReverseEntry *prev; /**< wskaźnik na poprzedni element listy */
+    struct ReverseList *list; /**< wskaźnik na listę, do której należy element */
+    const char *number; /**< wskaźnik na przekierowywany prefiks w puli numerów bazy */
+    bool published; /**< czy element jest w posortowanej części listy, a nie wśród elementów oczekujących */
+};
+
+/** @brief Lista prefiksów, które przekierowują się na węzeł.
+ * Lista składa się z części posortowanej leksykograficznie, którą przeglądają wątki
+ * czytające, i z elementów oczekujących, widocznych tylko dla wątków zmieniających bazę.
+ * Element nie mniejszy od ostatniego elementu części posortowanej jest od razu do niej
+ * dopisywany; pozostałe czekają, a lista jest oznaczana jako nieposortowana.
+ * Elementy części posortowanej nigdy nie są przestawiane, bo mogą je w tym czasie
+ * przeglądać inne wątki. Oczekujące elementy są sortowane i wstawiane na swoje miejsca
+ * pod blokadą pasma węzła: przez @ref phfwdFreeze, po dodaniu porcji przekierowań albo
+ * przez pierwsze wywołanie @ref phfwdReverse, które natrafi na nieposortowaną listę.
+ * Dzięki temu @ref phfwdReverse scala listy bezpośrednio, bez kopiowania.
+ */
+struct ReverseList {
+
+    struct ReverseEntry *head; /**< wskaźnik na pierwszy element części posortowanej */
+    struct ReverseEntry *last; /**< wskaźnik na ostatni element części posortowanej */
+    struct ReverseEntry *pending; /**< wskaźnik na pierwszy element oczekujący lub NULL */
+    struct ForwardNode *owner; /**< wskaźnik na węzeł, na który przekierowują się prefiksy z listy */
+    struct Arena *arena; /**< wskaźnik na alokator pasma węzła, z którego pochodzą lista i jej elementy */
+    bool sorted; /**< czy lista nie ma elementów oczekujących */
+};
+
+/** @brief Węzeł drzewa przekierowań.
+ * Drzewo jest skompresowane: krawędź prowadząca do węzła jest opisana ciągiem cyfr
+ * (etykietą), a nie pojedynczą cyfrą, więc łańcuchy węzłów z jednym synem i bez
+ * przekierowań są zwinięte w jeden węzeł. Każdy węzeł reprezentuję prefiks będący
+ * złożeniem etykiet na ścieżce od korzenia. Etykieta zaczyna się od cyfry, pod którą
+ * węzeł jest zapisany u ojca, a jej znaki leżą w pamięci zaraz za tablicą synów.
+ * Synowie przechowywani są w tablicy o rozmiarze dopasowanym do faktycznej liczby
+ * synów (0, 1, 4 lub 12 miejsc). Które cyfry mają syna mówi maska @p occupancy,
+ * a syn dla danej cyfry leży w tablicy na pozycji równej liczbie zapalonych bitów
+ * maski dla mniejszych cyfr.
  * W węźle przechowywane jest prefiks, na który przekierowywany jest dany numer,
  * ale także lista prefiksów, które przekierowują się na ten numer.
+ * Synowie i lista przekierowań na węzeł wskazują na węzeł, więc przy przeniesieniu
+ * węzła w inne miejsce pamięci te wskaźniki są aktualizowane.
+ * Maska @p reverseMask jest podsumowaniem poddrzew synów aktualizowanym przy każdym
+ * pojawieniu się i zniknięciu listy przekierowań na węzeł.
+ */
+struct ForwardNode {
+
+    const char *fwdTo; /**< wskaźnik na prefiks w puli numerów bazy, na który przekierowywany jest węzeł */
+    struct ReverseList *fwdFrom; /**< wskaźnik na listę prefiksów, które przekierowują się na węzeł, lub NULL, jeśli jest pusta */
+    struct ReverseEntry *fwdEntry; /**< wskaźnik na element listy węzła, na który przekierowywany jest węzeł, lub NULL */
+    struct ForwardNode *parent; /**< wskaźnik na ojca węzła lub NULL dla korzenia */
+    uint32_t labelLength; /**< długość etykiety krawędzi prowadzącej do węzła */
+    uint16_t occupancy; /**< maska bitowa cyfr, dla których węzeł ma syna */
+    uint16_t reverseMask; /**< maska bitowa cyfr, dla których w poddrzewie syna jest węzeł z niepustą listą przekierowań na niego */
+    uint8_t capacity; /**< liczba miejsc w tablicy synów */
+    struct ForwardNode *children[]; /**< synowie węzła uporządkowani rosnąco według cyfry, a za nimi etykieta */
+};
+
+/** @brief Zapamiętany wynik @ref phfwdNonTrivialCount.
+ * Wynik jest aktualny tylko wtedy, gdy numer zmiany bazy, przy którym go policzono,
+ * jest równy bieżącemu numerowi zmiany bazy.
+ */
+struct CountCacheEntry {
+
+    uint64_t generation; /**< numer zmiany bazy, przy którym policzono wynik, lub 0 dla pustego miejsca */
+    size_t len; /**< długość zliczanych numerów */
+    size_t result; /**< wynik zliczania */
+    uint16_t digits; /**< maska bitowa cyfr zbioru */
+};
+
+/** @brief Miejsce wątku, który czyta bazę.
+ * Zajmuje całą linię pamięci podręcznej, więc wątki czytające nie zapisują tej samej linii.
+ */
+struct ReaderSlot {
+
+    uint64_t epoch; /**< epoka bazy z początku odczytu lub 0, jeśli miejsce jest wolne */
+    char padding[CACHE_LINE_SIZE - sizeof(uint64_t)]; /**< dopełnienie do rozmiaru linii */
+};
+
+/** @brief Pasmo bazy, czyli poddrzewo korzenia dla jednej pierwszej cyfry numeru.
+ * Węzły pasma, ich listy przekierowań na węzeł i elementy tych list są zmieniane
+ * tylko pod blokadą pasma i przydzielane z jego alokatora.
+ */
+struct WriterStripe {
+
+    pthread_mutex_t lock; /**< blokada pasma */
+    struct Arena arena; /**< alokator pamięci pasma */
+    uint64_t sealedEpoch; /**< epoka, w której zamknięto grupę zwolnionych bloków pasma czekającą na czytelników */
+};
+
+/** @brief Struktura przechowująca przekierowania numerów telefonów.
+ * Struktura przechowuję przekierowania numerów w drzewie, którego węzłami są
+ * struktury @ref ForwardNode. Korzeń ma zawsze syna dla każdej cyfry; synowie korzenia
+ * mogą być puści i nigdy nie są usuwani, więc każde pasmo (@ref WriterStripe) ma stałe
+ * miejsce w tablicy synów korzenia.
+ * Węzły i elementy list przekierowań na węzeł są przydzielane z alokatorów pasm,
+ * a korzeń i numery z alokatora należącego do struktury, więc usunięcie bazy zwalnia
+ * je wszystkie naraz.
+ * Każdy numer występujący w przekierowaniach jest przechowywany raz w puli numerów,
+ * a węzły i listy odwołują się do niego wskaźnikiem.
+ * Każde dodanie i usunięcie przekierowań zwiększa numer zmiany bazy, co unieważnia
+ * wszystkie zapamiętane wyniki zliczania numerów nietrywialnych.
+ * Bazę może zmieniać jednocześnie wiele wątków. Zmiana blokuje pasma, których dotyka:
+ * dodanie pasma obu prefiksów i pasmo poprzedniego celu przekierowania, usunięcie pasmo
+ * prefiksu i pasma celów usuwanych przekierowań. Blokady pasm są zawsze brane w kolejności
+ * rosnących cyfr, a pula numerów ma osobną blokadę, braną zawsze jako ostatnią, więc
+ * zmiany nie mogą się wzajemnie zakleszczyć.
+ * Współbieżnie ze zmianami dowolnie wiele wątków może wyznaczać przekierowania
+ * (@ref phfwdGet, @ref phfwdGetInto, @ref phfwdGetBatch, @ref phfwdReverse)
+ * bez blokad; jedynie @ref phfwdReverse blokuje pasmo numeru, gdy musi posortować listę
+ * przekierowań na węzeł (zob. @ref ReverseList). Zmiany są publikowane atomowymi zapisami
+ * wskaźników, a węzły i napisy odłączone od drzewa są zwalniane dopiero wtedy, gdy
+ * żaden czytelnik nie może ich już widzieć. Czytelnik zajmuje na czas odczytu miejsce
+ * w tablicy @p readers i zapisuje w nim bieżącą epokę bazy. Wątek zmieniający bazę
+ * zamyka grupę zwolnionych bloków alokatora, zwiększając epokę, i oddaje je do ponownego
+ * użycia, gdy każdy czytelnik zajmujący miejsce zaczął odczyt w tej epoce lub później.
  */
-struct PhoneForward{
+struct PhoneForward {
 
-    struct PhoneForward *children[12]; /**< wskaźnik na poddrzewa reprezentujące kolejną liczbę w prefiksie (0-9) */
-    char *fwdTo; /**< wskaźnik na prefiks na który przekierowywany jest węzeł */
-    struct PhoneNumbers *fwdFrom; /**< wskaźnik na listę prefiksów, które przekierowują się na węzeł */
+    struct ForwardNode *root; /**< wskaźnik na korzeń drzewa przekierowań */
+    struct Arena arena; /**< alokator pamięci korzenia i numerów bazy */
+    struct NumberPool numbers; /**< pula numerów bazy */
+    pthread_mutex_t numbersLock; /**< blokada puli numerów i jej alokatora */
+    struct WriterStripe stripes[WRITER_STRIPES]; /**< pasma bazy */
+    uint64_t generation; /**< numer zmiany bazy, zaczyna się od 1 */
+    struct CountCacheEntry countCache[COUNT_CACHE_SIZE]; /**< zapamiętane wyniki zliczania numerów nietrywialnych */
+    struct ReaderSlot *readers; /**< tablica @ref READER_SLOTS miejsc czytelników */
+    uint64_t epoch; /**< bieżąca epoka bazy, zaczyna się od 1 */
+    uint64_t sealedEpoch; /**< epoka, w której zamknięto grupę zwolnionych bloków puli numerów czekającą na czytelników */
+    struct WorkerPool countPool; /**< pula wątków @ref phfwdNonTrivialCountParallel */
 };
 
 /** @brief Struktura przechowująca ciąg numerów telefonów.
+ * Cały ciąg leży w jednym bloku pamięci: za nagłówkiem jest tablica pozycji,
+ * a za nią obszar, w którym kolejne numery są zapisane jeden za drugim,
+ * każdy zakończony znakiem '\0'.
  */
 struct PhoneNumbers {
 
-    struct PhoneNumbers *next; /**< wskaźnik na następny element w liście */
-    char *number; /**< wskaźnik na napis reprezentujący numer telefonu */
+    size_t count; /**< liczba numerów w ciągu */
+    size_t offsets[]; /**< pozycje kolejnych numerów w obszarze za tablicą */
+};
+
+/** @brief Przekierowanie podawane do @ref phfwdAddBatch.
+ */
+struct ForwardPair {
+
+    char const *from; /**< wskaźnik na napis reprezentujący prefiks numerów przekierowywanych */
+    char const *to; /**< wskaźnik na napis reprezentujący prefiks numerów, na które jest wykonywane przekierowanie */
+};
+
+/** @brief Węzeł migawki bazy przekierowań.
+ * Węzły migawki leżą w jednej tablicy w kolejności przechodzenia drzewa wszerz, więc
+ * synowie węzła zajmują w niej kolejne pozycje, uporządkowane rosnąco według cyfry.
+ * Zamiast wskaźników węzeł przechowuje indeksy w tablicach migawki i pozycje w jej
+ * obszarze napisów.
+ */
+struct FrozenNode {
+
+    uint32_t parent; /**< indeks ojca lub @ref FROZEN_NONE dla korzenia */
+    uint32_t firstChild; /**< indeks pierwszego syna */
+    uint32_t label; /**< pozycja etykiety krawędzi prowadzącej do węzła w obszarze napisów */
+    uint32_t labelLength; /**< długość etykiety krawędzi prowadzącej do węzła */
+    uint32_t fwdTo; /**< pozycja prefiksu, na który przekierowywany jest węzeł, lub @ref FROZEN_NONE */
+    uint32_t fwdFrom; /**< indeks pierwszego elementu listy przekierowań na węzeł lub @ref FROZEN_NONE */
+    uint16_t occupancy; /**< maska bitowa cyfr, dla których węzeł ma syna */
+    uint16_t reverseMask; /**< maska bitowa cyfr, dla których w poddrzewie syna jest węzeł z niepustą listą przekierowań na niego */
+};
+
+/** @brief Niezmienna migawka bazy przekierowań.
+ * Migawka zajmuje jeden blok pamięci: za nagłówkiem leżą tablica węzłów, tablica
+ * elementów list przekierowań na węzły i obszar napisów. Elementami list są pozycje
+ * numerów w obszarze napisów; każda lista jest posortowana leksykograficznie
+ * i zakończona wartością @ref FROZEN_NONE. Każdy numer bazy jest zapisany w obszarze
+ * napisów raz, zakończony znakiem '\0', a za numerami leżą etykiety węzłów w kolejności
+ * węzłów i jeden znak '\0' zamykający obszar.
+ * Wszystkie odwołania wewnątrz bloku są względne, więc blok można przenosić, zapisać
+ * do pliku i używać bezpośrednio po odwzorowaniu pliku w pamięć. Pola @p magic i @p version
+ * pozwalają rozpoznać blok w innej wersji układu lub zapisany na maszynie o innej
+ * kolejności bajtów.
+ */
+struct FrozenForward {
 
+    uint32_t magic; /**< równe @ref FROZEN_MAGIC */
+    uint32_t version; /**< równe @ref FROZEN_VERSION */
+    uint64_t size; /**< rozmiar całego bloku w bajtach */
+    uint64_t nodesOffset; /**< pozycja tablicy węzłów względem początku bloku */
+    uint64_t entriesOffset; /**< pozycja tablicy elementów list względem początku bloku */
+    uint64_t stringsOffset; /**< pozycja obszaru napisów względem początku bloku */
+    uint32_t nodeCount; /**< liczba węzłów; korzeń ma indeks 0 */
+    uint32_t entryCount; /**< liczba elementów list razem z wartościami kończącymi */
+    uint32_t stringsSize; /**< rozmiar obszaru napisów w bajtach */
+    uint32_t reserved; /**< nieużywane, równe 0 */
 };
 
 /** @brief Tworzy nową strukturę.
@@ -56,6 +246,7 @@ void phfwdDelete(struct PhoneForward *pf);
  * w których ten prefiks zamieniono odpowiednio na prefiks @p num2. Każdy numer
  * jest swoim własnym prefiksem. Jeśli wcześniej zostało dodane przekierowanie
  * z takim samym parametrem @p num1, to jest ono zastępowane.
+ * Może działać współbieżnie z odczytami i z innymi zmianami bazy.
  * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
  *                   przekierowywanych;
@@ -68,10 +259,48 @@ void phfwdDelete(struct PhoneForward *pf);
  */
 bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje porcję przekierowań.
+ * Daje taką samą bazę jak wywołanie @ref phfwdAdd kolejno dla wszystkich par z tablicy:
+ * niepoprawne pary są pomijane, a z kilku par o tym samym prefiksie przekierowywanym
+ * obowiązuje ostatnia. Pary są sortowane według prefiksów docelowych i przekierowywanych,
+ * a węzły obu rodzajów są wyznaczane w jednym przejściu każdego z porządków, od wspólnego
+ * prefiksu z poprzednim numerem, zamiast od korzenia dla każdej pary.
+ * Blokuje wszystkie pasma bazy na czas dodawania. Może działać współbieżnie z odczytami
+ * i z innymi zmianami bazy.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] pairs – tablica dodawanych przekierowań;
+ * @param[in] n     – liczba przekierowań w tablicy.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli któraś para nie reprezentuje przekierowania
+ *         (pozostałe pary są wtedy dodawane) lub nie udało się zaalokować pamięci
+ *         (wtedy każdy prefiks z porcji jest przekierowany tak jak przed wywołaniem
+ *         albo tak jak w porcji).
+ */
+bool phfwdAddBatch(struct PhoneForward *pf, struct ForwardPair const pairs[], size_t n);
+
+/** @brief Dodaje porcję przekierowań na wielu wątkach.
+ * Działa jak @ref phfwdAddBatch i daje taką samą bazę. Porcja jest dzielona według pasm,
+ * czyli pierwszych cyfr numerów, a części są przetwarzane przez @p threads wątków, z których
+ * każdy zmienia tylko poddrzewo i alokator pasma swojej części. Prefiksy przekierowywane
+ * i docelowe są rozdzielane osobno, więc elementy list przekierowań na węzły są dopisywane
+ * w pasmach celów, przekierowania ustawiane w pasmach prefiksów przekierowywanych, a elementy
+ * zastąpionych przekierowań usuwane w osobnym etapie, w pasmach poprzednich celów.
+ * Wątków jest co najwyżej tyle, ile pasm ma przekierowania z porcji.
+ * Blokuje wszystkie pasma bazy na czas dodawania. Może działać współbieżnie z odczytami
+ * i z innymi zmianami bazy.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] pairs   – tablica dodawanych przekierowań;
+ * @param[in] n       – liczba przekierowań w tablicy;
+ * @param[in] threads – liczba wątków; wartości 0 i 1 oznaczają dodawanie na wątku wywołującym.
+ * @return Wartość zwracana przez @ref phfwdAddBatch.
+ */
+bool phfwdAddBatchParallel(struct PhoneForward *pf, struct ForwardPair const pairs[], size_t n, size_t threads);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
  * lub napis nie reprezentuje numeru, nic nie robi.
+ * Może działać współbieżnie z odczytami i z innymi zmianami bazy.
  *
  * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
@@ -84,18 +313,54 @@ void phfwdRemove(struct PhoneForward *pf, char const *num);
  * przekierowany, to wynikiem jest ten numer. Jeśli podany napis nie
  * reprezentuje numeru, wynikiem jest pusty ciąg. Alokuje strukturę
  * @p PhoneNumbers,która musi być zwolniona za pomocą funkcji @ref phnumDelete.
+ * Może być wywoływana współbieżnie z innymi odczytami i ze zmianami bazy.
  * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] num – wskaźnik na napis reprezentujący numer.
  * @return Wskaźnik na strukturę przechowującą ciąg numerów.
  */
 struct PhoneNumbers const * phfwdGet(struct PhoneForward *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru do bufora podanego przez wywołującego.
+ * Działa jak @ref phfwdGet, ale nie alokuje pamięci: wynik jest zapisywany
+ * w buforze @p buf jako napis zakończony znakiem '\0', o ile mieści się w nim
+ * razem z tym znakiem. W przeciwnym razie zawartość bufora nie jest zmieniana.
+ * Jeśli podany napis nie reprezentuje numeru, a @p cap jest dodatnie,
+ * w buforze zapisywany jest pusty napis.
+ * Może być wywoływana współbieżnie z innymi odczytami i ze zmianami bazy.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer;
+ * @param[out] buf – wskaźnik na bufor na wynik;
+ * @param[in] cap – rozmiar bufora w bajtach.
+ * @return Długość wyniku bez kończącego znaku '\0'. Wynik został zapisany
+ *         wtedy i tylko wtedy, gdy jest mniejszy od @p cap. Wartość 0, jeśli
+ *         podany napis nie reprezentuje numeru.
+ */
+size_t phfwdGetInto(struct PhoneForward *pf, char const *num, char *buf, size_t cap);
+
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Wynik jest taki sam jak wywołanie @ref phfwdGet dla każdego numeru z osobna,
+ * ale wyszukiwania kolejnych numerów są prowadzone naprzemiennie, więc oczekiwanie
+ * na pobranie węzłów z pamięci nakłada się na siebie. Jeśli @p pf ma wartość NULL,
+ * każdy wynik jest pustym ciągiem, jak dla napisu, który nie reprezentuje numeru.
+ * Może być wywoływana współbieżnie z innymi odczytami i ze zmianami bazy.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] n    – liczba numerów;
+ * @param[out] out – tablica, w której na pozycji @p i zostanie zapisany wynik
+ *                   dla numeru @p nums[i] (jak w @ref phfwdGet). Każdy wynik musi
+ *                   być zwolniony za pomocą funkcji @ref phnumDelete.
+ */
+void phfwdGetBatch(struct PhoneForward *pf, char const * const nums[], size_t n, struct PhoneNumbers const *out[]);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza wszystkie przekierowania na podany numer. Wynikowy ciąg zawiera też
  * dany numer. Wynikowe numery są posortowane leksykograficznie i nie mogą się
  * powtarzać. Jeśli podany napis nie reprezentuje numeru, wynikiem jest pusty
  * ciąg. Alokuje strukturę @p PhoneNumbers, która musi być zwolniona za pomocą
  * funkcji @ref phnumDelete.
+ * Może być wywoływana współbieżnie z innymi odczytami i ze zmianami bazy. Listy
+ * przekierowań na węzły są scalane bezpośrednio; jeśli któraś z nich ma elementy
+ * oczekujące na posortowanie, funkcja sortuje ją pod blokadą pasma numeru.
  * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] num – wskaźnik na napis reprezentujący numer.
  * @return Wskaźnik na strukturę przechowującą ciąg numerów.
@@ -118,12 +383,26 @@ void phnumDelete(struct PhoneNumbers const *pnum);
  */
 char const * phnumGet(struct PhoneNumbers const *pnum, size_t idx);
 
+/** @brief Kopiuje wszystkie numery ciągu do bufora.
+ * Numery są zapisywane w buforze jeden za drugim, każdy zakończony znakiem nowej
+ * linii, o ile mieszczą się w nim wszystkie. W przeciwnym razie zawartość bufora
+ * nie jest zmieniana. Wynik nie jest zakończony znakiem '\0'.
+ * @param[in] pnum – wskaźnik na strukturę przechowującą ciąg napisów;
+ * @param[out] buf – wskaźnik na bufor na wynik;
+ * @param[in] cap  – rozmiar bufora w bajtach.
+ * @return Łączna długość numerów ze znakami nowej linii. Wynik został zapisany
+ *         wtedy i tylko wtedy, gdy nie jest większy od @p cap. Wartość 0, jeśli
+ *         @p pnum ma wartość NULL lub ciąg jest pusty.
+ */
+size_t phnumCopyLines(struct PhoneNumbers const *pnum, char *buf, size_t cap);
+
 /** @brief Oblicza liczbę nietrywialnych numerów telefonów zawierających konkretne cyfry i o podanej długości.
  * Numerem nietrywialnym nazywamy numer, dla którego w wyniku wywołania @ref phfwdReverse dla tego numeru
  * pojawia się numer inny niż on sam. Funkcja oblicza liczbę nietrywialnych numerów długości len zawierających tylko cyfry,
  * które znajdują się w napisie set. Wynik funkcji to liczba tych numerów modulo dwa do potęgi liczba bitów reprezentacji typu size_t.
  * Jeśli wskaźnik pf ma wartość NULL, set ma wartość NULL, set jest pusty,set nie zawiera żadnej cyfry
  * lub parametr len jest równy zeru, wynikiem jest zero.
+ * Zapamiętuje wyniki w bazie, więc nie może działać współbieżnie ze zmianami bazy ani z innymi wywołaniami tej funkcji.
  * @param[in] pf  - wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
  * @param[in] len - długość wyznaczanych numerów.
@@ -131,4 +410,104 @@ char const * phnumGet(struct PhoneNumbers const *pnum, size_t idx);
  */
 size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len);
 
+/** @brief Oblicza liczbę nietrywialnych numerów telefonów na wielu wątkach.
+ * Działa jak @ref phfwdNonTrivialCount i daje ten sam wynik. Drzewo jest dzielone na poddrzewa
+ * kilka poziomów pod korzeniem, a poddrzewa są przechodzone przez co najwyżej @p threads wątków,
+ * ale nie więcej niż jest poddrzew. Wątki po wyczerpaniu swoich zadań zabierają zadania innym
+ * wątkom. Wyniki wątków są sumowane modulo dwa do potęgi liczba bitów reprezentacji typu size_t.
+ * Wątki należą do puli bazy: są uruchamiane przy pierwszym zliczaniu, które ich potrzebuje,
+ * i czekają na kolejne zliczania aż do usunięcia bazy.
+ * Zapamiętuje wyniki w bazie, więc nie może działać współbieżnie ze zmianami bazy ani z innymi
+ * wywołaniami funkcji zliczających.
+ * @param[in] pf  - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
+ * @param[in] len - długość wyznaczanych numerów;
+ * @param[in] threads - liczba wątków wliczając wywołujący; wartości 0 i 1 oznaczają zliczanie
+ *                      na wątku wywołującym.
+ * @return Ilość numerów wyspecyfikowanych w opisie funkcji @ref phfwdNonTrivialCount.
+ */
+size_t phfwdNonTrivialCountParallel(struct PhoneForward *pf, char const *set, size_t len, size_t threads);
+
+/** @brief Oblicza liczbę nietrywialnych numerów telefonów na wątkach wywołującego.
+ * Działa jak @ref phfwdNonTrivialCountParallel, ale poddrzewa są przechodzone na wątkach
+ * podanego wykonawcy zamiast na wątkach puli bazy, więc wywołujący, który ma już swoje wątki,
+ * nie musi uruchamiać kolejnych.
+ * Zapamiętuje wyniki w bazie, więc nie może działać współbieżnie ze zmianami bazy ani z innymi
+ * wywołaniami funkcji zliczających.
+ * @param[in] pf  - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
+ * @param[in] len - długość wyznaczanych numerów;
+ * @param[in] executor - wskaźnik na wykonawcę zadań;
+ * @param[in] threads - liczba wątków wliczając wywołujący; wartości 0 i 1 oznaczają zliczanie
+ *                      na wątku wywołującym bez udziału wykonawcy.
+ * @return Ilość numerów wyspecyfikowanych w opisie funkcji @ref phfwdNonTrivialCount.
+ */
+size_t phfwdNonTrivialCountOn(struct PhoneForward *pf, char const *set, size_t len, struct ParallelExecutor const *executor, size_t threads);
+
+/** @brief Zapisuje bazę do pliku.
+ * Zapis zawiera węzły drzewa w kolejności przechodzenia w głąb: dla każdego węzła maskę
+ * jego synów, etykietę i, jeśli węzeł jest przekierowany, numer węzła docelowego.
+ * Listy przekierowań na węzły nie są zapisywane, bo wynikają z przekierowań.
+ * Liczby są zapisane w kolejności bajtów maszyny, na której zapisano bazę.
+ * Nie może działać współbieżnie ze zmianami bazy.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] fd – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true jeśli baza została zapisana,
+ *         wartość @p false, jeśli @p pf ma wartość NULL, nie udało się zaalokować
+ *         pamięci lub zapis się nie powiódł.
+ */
+bool phfwdSave(struct PhoneForward *pf, int fd);
+
+/** @brief Wczytuje bazę zapisaną przez @ref phfwdSave.
+ * Węzły są tworzone od razu z docelowym rozmiarem, bez wyszukiwania ich od korzenia,
+ * a listy przekierowań na węzły są odtwarzane w jednym przebiegu po wczytaniu drzewa.
+ * Odczyt jest buforowany, więc z pliku mogą zostać pobrane bajty leżące za zapisem bazy.
+ * @param[in] fd – deskryptor pliku otwartego do odczytu.
+ * @return Wskaźnik na wczytaną strukturę lub NULL, jeśli plik nie zawiera poprawnego
+ *         zapisu bazy, odczyt się nie powiódł lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForward * phfwdLoad(int fd);
+
+/** @brief Tworzy niezmienną migawkę bazy przekierowań.
+ * Migawka odpowiada na te same zapytania co baza, ale zajmuje mniej pamięci i jej
+ * przeglądanie wymaga mniej odwołań do rozproszonych miejsc w pamięci. Późniejsze
+ * zmiany bazy nie wpływają na migawkę. Nie może działać współbieżnie ze zmianami bazy.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na utworzoną migawkę, którą należy zwolnić za pomocą funkcji
+ *         @ref phfwdFrozenDelete, lub NULL, gdy @p pf ma wartość NULL, nie udało
+ *         się zaalokować pamięci albo baza jest za duża na zapis w migawce.
+ */
+struct FrozenForward * phfwdFreeze(struct PhoneForward *pf);
+
+/** @brief Usuwa migawkę.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] ff – wskaźnik na usuwaną migawkę.
+ */
+void phfwdFrozenDelete(struct FrozenForward const *ff);
+
+/** @brief Wyznacza przekierowanie numeru w migawce.
+ * Działa jak @ref phfwdGet dla bazy, z której utworzono migawkę.
+ * @param[in] ff  – wskaźnik na migawkę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów.
+ */
+struct PhoneNumbers const * phfwdFrozenGet(struct FrozenForward const *ff, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w migawce.
+ * Działa jak @ref phfwdReverse dla bazy, z której utworzono migawkę.
+ * @param[in] ff  – wskaźnik na migawkę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów.
+ */
+struct PhoneNumbers const * phfwdFrozenReverse(struct FrozenForward const *ff, char const *num);
+
+/** @brief Oblicza liczbę nietrywialnych numerów w migawce.
+ * Działa jak @ref phfwdNonTrivialCount dla bazy, z której utworzono migawkę.
+ * @param[in] ff  - wskaźnik na migawkę;
+ * @param[in] set - wskaźnik na napis reprezentujący zbiór cyfr;
+ * @param[in] len - długość wyznaczanych numerów.
+ * @return Ilość numerów modulo dwa do potęgi liczby bitów reprezentacji typu size_t.
+ */
+size_t phfwdFrozenNonTrivialCount(struct FrozenForward const *ff, char const *set, size_t len);
+
 #endif /* __PHONE_FORWARD_H__ */
@@ -6,20 +6,38 @@
  * @date 09.04.2018
  */
 
+#define _POSIX_C_SOURCE 200809L /**< udostępnia funkcje POSIX przy kompilacji w trybie C11 */
+
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "journal.h"
 #include "phone_forward.h"
 
 #define ERROR 3 /**<informuję o błędzie wystąpieniu błędu składniowego we wczytywaniu komentarza */
 #define SUCCESS 4 /**<informuję o sukcesie wczytania komentarza */
-#define STARTING_SIZE 10 /**< początkowy rozmiar tablicy na wczytywanie liczb i identyfikatorów */
-#define MULTIPLIER 3 /**<licznik mnożnika rozmiaru tablicy do wczytywania liczb i identyfikatorów */
-#define DIVISOR 2 /**<mianownik mnożnika rozmiaru tablicy do wczytywania liczb i identyfikatorów */
+#define MULTIPLIER 3 /**<licznik mnożnika rozmiaru powiększanych buforów */
+#define DIVISOR 2 /**<mianownik mnożnika rozmiaru powiększanych buforów */
 #define NOTHING_LOADED 1 /**< informuję o nie wczytaniu, żadnego znaku przy wczytywaniu białych znaków i komentarzy */
 #define SUCCESSFULLY_LOADED 2 /**< informuję o poprawnym wczytaniu białych znaków i komentarzy (przynajmniej jeden znak wczytany) */
 #define NUMBER_OF_DIGITS 12 /**<liczba znaków uznawanych za cyfry */
+#define GET_BUFFER_SIZE 256 /**< rozmiar bufora na wynik zapytania trzymanego w samym zapytaniu */
+#define PIPELINE_BATCH 4096 /**< maksymalna liczba zapytań czekających na wypisanie wyniku */
+#define PIPELINE_MAX_WORKERS 64 /**< maksymalna liczba wątków wykonujących zapytania */
+#define COUNT_BUFFER_SIZE 32 /**< rozmiar bufora na cyfry wyniku komendy @ */
+#define OUTPUT_BUFFER_SIZE 262144 /**< rozmiar bufora wyjścia */
+#define INPUT_BLOCK_SIZE 1048576 /**< początkowy rozmiar bufora wejścia, które nie jest zwykłym plikiem */
+#define PIPELINE_TEXT_SIZE 65536 /**< rozmiar bloku pamięci na numery zapytań w potoku */
+#define TOKEN_COPIES 2 /**< liczba tokenów komendy, których kopie są potrzebne jednocześnie */
 
 /** @brief Struktura przechowująca listę baz przekierowań.
  * Struktura przechowuję bazy przekierowań w formie listy.
@@ -30,11 +48,137 @@ struct ForwardTreeList {
     struct ForwardTreeList *next; /**< wskaźnik na następny element  */
     char *id; /**< wskaźnik na identyfikator */
     struct PhoneForward *pf; /**< wskaźnik na drzewo przekierowań */
+    struct Journal *journal; /**< wskaźnik na dziennik zmian bazy lub NULL, jeśli baza nie jest zapisywana */
+};
+
+/** @brief Katalog z dziennikami baz przekierowań.
+ * Ustawiany z argumentu programu. Wartość NULL oznacza, że bazy istnieją tylko w pamięci.
+ */
+static const char *journalDirectory = NULL;
+
+/** @brief Rodzaj zapytania tylko do odczytu.
+ */
+enum QueryKind {
+
+    QUERY_FORWARD, /**< komenda ? z numerem przed operatorem */
+    QUERY_REVERSE, /**< komenda ? z numerem po operatorze */
+    QUERY_COUNT /**< komenda @ */
+};
+
+/** @brief Zapytanie czekające w potoku na wykonanie i wypisanie wyniku.
+ */
+struct Query {
+
+    enum QueryKind kind; /**< rodzaj zapytania */
+    struct PhoneForward *pf; /**< wskaźnik na bazę, której dotyczy zapytanie */
+    const char *num; /**< wskaźnik na numer będący argumentem zapytania, w pamięci potoku, lub NULL */
+    int byteNumber; /**< numer pierwszego znaku operatora, podawany w komunikacie o błędzie */
+    char *output; /**< wskaźnik na wynik zapytania do wypisania: @p inlineOutput, zaalokowany bufor lub NULL */
+    size_t length; /**< długość wyniku w bajtach */
+    bool failed; /**< czy wykonanie zapytania nie powiodło się z powodu braku pamięci */
+    char inlineOutput[GET_BUFFER_SIZE]; /**< bufor na wynik, który się w nim mieści */
+};
+
+/** @brief Blok pamięci na numery zapytań czekających w potoku.
+ */
+struct TextChunk {
+
+    struct TextChunk *next; /**< wskaźnik na poprzednio zapełniany blok */
+    size_t used; /**< liczba zajętych bajtów */
+    size_t capacity; /**< rozmiar bloku w bajtach */
+    char text[]; /**< zawartość bloku */
+};
+
+/** @brief Potok wykonujący zapytania tylko do odczytu.
+ * Wątek główny wczytuje komendy i odkłada kolejne zapytania do potoku, nie czekając na ich wynik.
+ * Zapytania są od razu pobierane przez wątki robocze, które wykonują je współbieżnie
+ * i zapisują wyniki w zapytaniach. Przed każdą zmianą baz, przed zakończeniem programu
+ * i po zapełnieniu potoku wątek główny pomaga wykonać pozostałe zapytania, czeka na wszystkie
+ * i wypisuje ich wyniki w kolejności komend na wejściu.
+ * Zapytanie może zlecić potokowi zadanie równoległe (@ref pipelineExecutorRun); wątki robocze,
+ * które nie mają zapytań do wykonania, i czekający wątek główny dołączają wtedy do zadania.
+ */
+struct QueryPipeline {
+
+    pthread_mutex_t lock; /**< blokada chroniąca liczniki potoku */
+    pthread_cond_t pending; /**< sygnalizuje wątkom roboczym nowe zapytanie lub zamknięcie potoku */
+    pthread_cond_t finished; /**< sygnalizuje wątkowi głównemu wykonanie wszystkich zapytań lub nowe zadanie równoległe */
+    pthread_cond_t jobDone; /**< sygnalizuje zakończenie ostatniego wywołania zadania równoległego przez dołączony wątek */
+    struct Query queries[PIPELINE_BATCH]; /**< zapytania w kolejności komend na wejściu */
+    size_t count; /**< liczba zapytań w potoku */
+    size_t next; /**< indeks pierwszego zapytania niepobranego jeszcze do wykonania */
+    size_t done; /**< liczba wykonanych zapytań */
+    bool closing; /**< czy wątki robocze mają się zakończyć */
+    void (*job)(void *argument); /**< wykonywane zadanie równoległe */
+    void *jobArgument; /**< argument wykonywanego zadania równoległego */
+    size_t jobSlots; /**< liczba wątków, które mogą jeszcze dołączyć do zadania równoległego */
+    size_t jobActive; /**< liczba dołączonych wątków wykonujących zadanie równoległe */
+    size_t workers; /**< liczba uruchomionych wątków roboczych */
+    pthread_t threads[PIPELINE_MAX_WORKERS]; /**< uruchomione wątki robocze */
+    struct TextChunk *text; /**< bloki z numerami zapytań, od ostatnio zapełnianego */
+};
+
+/** @brief Potok zapytań programu.
+ */
+static struct QueryPipeline pipeline;
+
+/** @brief Bufor wyjścia programu.
+ * Wyniki zapytań są dopisywane do bufora i wypisywane, gdy bufor się zapełni, oraz przy
+ * zakończeniu programu. Wynik, który nie mieści się w buforze, jest wypisywany razem
+ * z zawartością bufora jednym wywołaniem writev, bez kopiowania.
+ */
+struct OutputWriter {
+
+    char buffer[OUTPUT_BUFFER_SIZE]; /**< zawartość bufora */
+    size_t length; /**< liczba bajtów w buforze */
+    bool failed; /**< czy zapis się nie powiódł; dalsze wyniki są wtedy pomijane */
 };
 
+/** @brief Wyjście programu.
+ */
+static struct OutputWriter output;
+
+/** @brief Wczytany numer lub identyfikator.
+ * Token nie jest kopiowany przy wczytywaniu, tylko wskazuje fragment wejścia.
+ */
+struct Token {
+
+    size_t offset; /**< pozycja pierwszego znaku tokenu liczona od początku wejścia */
+    size_t length; /**< liczba znaków tokenu */
+};
+
+/** @brief Wejście programu wczytywane blokami.
+ * Zwykły plik jest odwzorowywany w pamięci w całości. Inne wejście jest wczytywane blokami
+ * do bufora, z którego przy doczytywaniu usuwane są znaki sprzed bieżącej pozycji, o ile nie
+ * należą do tokenów bieżącej komendy, więc tokeny pozostają dostępne do końca komendy.
+ */
+struct InputReader {
+
+    const char *data; /**< wskaźnik na dostępne znaki wejścia */
+    size_t size; /**< liczba dostępnych znaków */
+    size_t position; /**< indeks następnego znaku do wczytania */
+    size_t base; /**< pozycja pierwszego dostępnego znaku liczona od początku wejścia */
+    char *buffer; /**< bufor bloków wejścia lub NULL, jeśli wejście jest odwzorowane w pamięci */
+    size_t capacity; /**< rozmiar bufora */
+    void *mapping; /**< początek odwzorowania pliku lub NULL */
+    size_t mappingSize; /**< rozmiar odwzorowania */
+    bool end; /**< czy nie ma już znaków do doczytania */
+    bool failed; /**< czy nie udało się powiększyć bufora */
+    bool pinning; /**< czy w bieżącej komendzie wczytano token */
+    size_t pinned; /**< pozycja pierwszego tokenu bieżącej komendy liczona od początku wejścia */
+    char *copies[TOKEN_COPIES]; /**< bufory na kopie tokenów zakończone znakiem '\0' */
+    size_t copySizes[TOKEN_COPIES]; /**< rozmiary buforów na kopie tokenów */
+};
+
+/** @brief Wejście programu.
+ */
+static struct InputReader input;
+
 /** @brief Tworzy nowy element listy baz przekierowań o podanym identyfikatorze.
+ * Jeśli ustawiono katalog z dziennikami, baza jest odtwarzana z dziennika o tym identyfikatorze.
  * @param[in] id - wskaźnik na identyfikator.
- * @return Wskaźnik na nowo powstały element lub NULL w przypadku błędu alokacji.
+ * @return Wskaźnik na nowo powstały element lub NULL w przypadku błędu alokacji
+ *         albo odtwarzania bazy z dziennika.
  */
 static struct ForwardTreeList *newFwdTreeListElement(const char *id) {
 
@@ -51,23 +195,35 @@ static struct ForwardTreeList *newFwdTreeListElement(const char *id) {
         }
 
         strcpy(pfListElement->id, id);
-        pfListElement->pf = phfwdNew();
+        pfListElement->journal = NULL;
+
+        if (journalDirectory == NULL)
+            pfListElement->pf = phfwdNew();
+
+        else if ((pfListElement->journal = journalOpen(journalDirectory, id, &(pfListElement->pf))) == NULL) {
+            free(pfListElement->id);
+            free(pfListElement);
+            return NULL;
+        }
     }
 
     return pfListElement;
 }
 
 /** @brief Zwalnia element listy baz przekierowań.
+ * Usuwa również dziennik bazy, bo baza przestaje istnieć.
  * @param[in,out] element - wskaźnik na zwalniany element.
  */
 static void delForwardListElement(struct ForwardTreeList *element) {
 
+    journalDiscard(element->journal);
     free(element->id);
     phfwdDelete(element->pf);
     free(element);
 }
 
 /** @brief Zwalnia listę baz przekierowań.
+ * Dzienniki baz są utrwalane i zamykane, więc bazy zostaną odtworzone przy następnym uruchomieniu.
  * @param[in,out] pfList - wskaźnik na zwalnianą listę.
  */
 static void delFwdTreeList(struct ForwardTreeList *pfList) {
@@ -75,6 +231,7 @@ static void delFwdTreeList(struct ForwardTreeList *pfList) {
     while (pfList != NULL) {
 
         struct ForwardTreeList *tmp = pfList;
+        journalClose(tmp->journal);
         free(tmp->id);
         phfwdDelete(tmp->pf);
         pfList = pfList->next;
@@ -82,6 +239,656 @@ static void delFwdTreeList(struct ForwardTreeList *pfList) {
     }
 }
 
+/** @brief Przygotowuje wczytywanie wejścia.
+ * Jeśli wejście jest zwykłym plikiem, odwzorowuje je w pamięci od bieżącej pozycji do końca.
+ * W przeciwnym razie, lub gdy odwzorowanie się nie powiedzie, wejście będzie wczytywane blokami.
+ */
+static void inputOpen(void) {
+
+    struct stat status;
+    off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+
+    if (offset < 0 || fstat(STDIN_FILENO, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= offset)
+        return;
+
+    void *mapping = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+
+    if (mapping == MAP_FAILED)
+        return;
+
+    posix_madvise(mapping, (size_t) status.st_size, POSIX_MADV_SEQUENTIAL);
+
+    input.mapping = mapping;
+    input.mappingSize = (size_t) status.st_size;
+    input.data = (const char *) mapping + offset;
+    input.size = (size_t) (status.st_size - offset);
+    input.end = true;
+}
+
+/** @brief Zwalnia pamięć wejścia.
+ */
+static void inputClose(void) {
+
+    if (input.mapping != NULL)
+        munmap(input.mapping, input.mappingSize);
+
+    free(input.buffer);
+
+    for (int i = 0; i < TOKEN_COPIES; i++)
+        free(input.copies[i]);
+}
+
+/** @brief Doczytuje kolejny blok wejścia do bufora.
+ * Najpierw usuwa z bufora znaki sprzed bieżącej pozycji i sprzed pierwszego tokenu bieżącej
+ * komendy, a jeśli bufor nadal jest pełny, powiększa go.
+ * @return Wartość @p true jeśli doczytano nowe znaki,
+ *         wartość @p false na końcu wejścia, przy błędzie odczytu lub gdy nie udało się
+ *         powiększyć bufora.
+ */
+static bool inputFill(void) {
+
+    if (input.end)
+        return false;
+
+    size_t keep = input.position;
+
+    if (input.pinning && input.pinned - input.base < keep)
+        keep = input.pinned - input.base;
+
+    if (keep > 0) {
+
+        memmove(input.buffer, input.buffer + keep, input.size - keep);
+        input.base += keep;
+        input.size -= keep;
+        input.position -= keep;
+    }
+
+    if (input.size == input.capacity) {
+
+        size_t capacity = (input.capacity == 0 ? INPUT_BLOCK_SIZE : MULTIPLIER * input.capacity / DIVISOR);
+        char *extended = realloc(input.buffer, capacity);
+
+        if (extended == NULL) {
+            input.end = true;
+            input.failed = true;
+            return false;
+        }
+
+        input.buffer = extended;
+        input.capacity = capacity;
+        input.data = extended;
+    }
+
+    ssize_t loaded;
+
+    do
+        loaded = read(STDIN_FILENO, input.buffer + input.size, input.capacity - input.size);
+    while (loaded < 0 && errno == EINTR);
+
+    if (loaded <= 0) {
+        input.end = true;
+        return false;
+    }
+
+    input.size += (size_t) loaded;
+
+    return true;
+}
+
+/** @brief Wczytuje znak z wejścia.
+ * Działa jak funkcja getchar.
+ * @return Wczytany znak przekształcony z typu unsigned char na int lub EOF, jeśli nie ma więcej znaków.
+ */
+static int inputGet(void) {
+
+    if (input.position == input.size && !inputFill())
+        return EOF;
+
+    return (unsigned char) input.data[input.position++];
+}
+
+/** @brief Cofa ostatnio wczytany znak wejścia.
+ * Działa jak funkcja ungetc, więc nic nie robi dla znaku równego EOF.
+ * @param[in] ch - ostatnio wczytany znak.
+ */
+static void inputUnget(char ch) {
+
+    if (ch != EOF)
+        input.position--;
+}
+
+/** @brief Pozwala usunąć z bufora wejścia tokeny poprzedniej komendy.
+ */
+static void inputUnpin(void) {
+
+    input.pinning = false;
+}
+
+/** @brief Zwraca początek tokenu w buforze wejścia.
+ * Wskaźnik jest ważny do końca komendy, w której wczytano token.
+ * @param[in] token - token.
+ * @return Wskaźnik na pierwszy znak tokenu.
+ */
+static const char *tokenText(struct Token token) {
+
+    return input.data + (token.offset - input.base);
+}
+
+/** @brief Sprawdza, czy token jest podanym słowem.
+ * @param[in] token - token;
+ * @param[in] word - wskaźnik na słowo.
+ * @return Wartość @p true jeśli token jest słowem @p word,
+ *         wartość @p false w przeciwnym razie.
+ */
+static bool tokenEquals(struct Token token, const char *word) {
+
+    return (token.length == strlen(word) && memcmp(tokenText(token), word, token.length) == 0);
+}
+
+/** @brief Kopiuje token do bufora kopii i kończy go znakiem '\0'.
+ * Kopia jest ważna do następnego kopiowania do tego samego bufora.
+ * @param[in] token - token;
+ * @param[in] slot - indeks bufora kopii, mniejszy od @ref TOKEN_COPIES.
+ * @return Wskaźnik na kopię lub NULL, gdy wystąpił problem z alokacją pamięci.
+ */
+static const char *tokenString(struct Token token, int slot) {
+
+    if (token.length + 1 > input.copySizes[slot]) {
+
+        char *extended = realloc(input.copies[slot], token.length + 1);
+
+        if (extended == NULL)
+            return NULL;
+
+        input.copies[slot] = extended;
+        input.copySizes[slot] = token.length + 1;
+    }
+
+    memcpy(input.copies[slot], tokenText(token), token.length);
+    input.copies[slot][token.length] = '\0';
+
+    return input.copies[slot];
+}
+
+/** @brief Kopiuje numer zapytania do pamięci potoku i kończy go znakiem '\0'.
+ * Bloki pamięci potoku nie są przenoszone, więc wątki robocze mogą czytać numery
+ * wcześniejszych zapytań w trakcie dopisywania kolejnych.
+ * @param[in] token - numer.
+ * @return Wskaźnik na kopię numeru lub NULL, gdy wystąpił problem z alokacją pamięci.
+ */
+static const char *pipelineText(struct Token token) {
+
+    struct TextChunk *chunk = pipeline.text;
+
+    if (chunk == NULL || chunk->capacity - chunk->used < token.length + 1) {
+
+        size_t capacity = (token.length + 1 > PIPELINE_TEXT_SIZE ? token.length + 1 : PIPELINE_TEXT_SIZE);
+
+        chunk = malloc(sizeof(struct TextChunk) + capacity);
+
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->next = pipeline.text;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        pipeline.text = chunk;
+    }
+
+    char *text = chunk->text + chunk->used;
+
+    memcpy(text, tokenText(token), token.length);
+    text[token.length] = '\0';
+    chunk->used += token.length + 1;
+
+    return text;
+}
+
+/** @brief Zwalnia bloki pamięci na numery zapytań.
+ * @param[in,out] chunk - wskaźnik na pierwszy zwalniany blok lub NULL.
+ */
+static void textChunksFree(struct TextChunk *chunk) {
+
+    while (chunk != NULL) {
+
+        struct TextChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+/** @brief Wypisuje fragmenty na standardowe wyjście.
+ * Ponawia zapis po częściowym zapisie i po przerwaniu sygnałem. Zapis zera bajtów
+ * jest błędem wyjścia.
+ * @param[in,out] parts - tablica fragmentów, zmieniana w trakcie zapisu;
+ * @param[in] count - liczba fragmentów.
+ */
+static void outputWrite(struct iovec *parts, int count) {
+
+    while (count > 0 && !output.failed) {
+
+        while (count > 0 && parts[0].iov_len == 0) {
+            parts++;
+            count--;
+        }
+
+        if (count == 0)
+            break;
+
+        ssize_t written = writev(STDOUT_FILENO, parts, count);
+
+        /* Zapis zera bajtów niepustych fragmentów nic nie posuwa, więc jest traktowany
+         * jak błąd, żeby pętla się nie zawiesiła. */
+        if (written == 0 || (written < 0 && errno != EINTR)) {
+            output.failed = true;
+            continue;
+        }
+
+        if (written < 0)
+            continue;
+
+        size_t remaining = (size_t) written;
+
+        while (count > 0 && remaining >= parts[0].iov_len) {
+            remaining -= parts[0].iov_len;
+            parts++;
+            count--;
+        }
+
+        if (count > 0) {
+            parts[0].iov_base = (char *) parts[0].iov_base + remaining;
+            parts[0].iov_len -= remaining;
+        }
+    }
+}
+
+/** @brief Wypisuje zawartość bufora wyjścia.
+ */
+static void outputFlush(void) {
+
+    if (output.length == 0)
+        return;
+
+    struct iovec part = {output.buffer, output.length};
+
+    outputWrite(&part, 1);
+    output.length = 0;
+}
+
+/** @brief Dopisuje bajty do bufora wyjścia.
+ * Jeśli bajty nie mieszczą się w buforze, bufor jest najpierw wypisywany. Jeśli nie
+ * zmieściłyby się także w pustym buforze, są wypisywane razem z nim.
+ * @param[in] data - wskaźnik na dopisywane bajty;
+ * @param[in] length - liczba bajtów.
+ */
+static void outputAppend(const char *data, size_t length) {
+
+    if (output.length + length > OUTPUT_BUFFER_SIZE) {
+
+        if (length >= OUTPUT_BUFFER_SIZE) {
+
+            struct iovec parts[2] = {{output.buffer, output.length}, {(void *) data, length}};
+
+            outputWrite(parts, 2);
+            output.length = 0;
+            return;
+        }
+
+        outputFlush();
+    }
+
+    memcpy(output.buffer + output.length, data, length);
+    output.length += length;
+}
+
+/** @brief Zapewnia zapytaniu bufor na wynik o podanym rozmiarze.
+ * Bufor w zapytaniu jest zastępowany zaalokowanym, jeśli jest za mały.
+ * @param[in,out] query - wskaźnik na zapytanie;
+ * @param[in] size - wymagany rozmiar bufora.
+ * @return Wartość @p true jeśli bufor ma wymagany rozmiar,
+ *         wartość @p false, gdy wystąpił problem z alokacją pamięci.
+ */
+static bool queryReserve(struct Query *query, size_t size) {
+
+    if (size <= GET_BUFFER_SIZE)
+        return true;
+
+    query->output = malloc(sizeof(char) * size);
+
+    if (query->output == NULL) {
+        query->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+/** @brief Zapisuje liczbę dziesiętnie, zakończoną znakiem nowej linii.
+ * @param[in] value - zapisywana liczba;
+ * @param[out] buffer - wskaźnik na bufor o rozmiarze co najmniej @ref COUNT_BUFFER_SIZE.
+ * @return Liczba zapisanych znaków.
+ */
+static size_t formatCount(size_t value, char *buffer) {
+
+    char digits[COUNT_BUFFER_SIZE];
+    size_t length = 0;
+
+    do {
+        digits[length] = (char) ('0' + value % 10);
+        length++;
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < length; i++)
+        buffer[i] = digits[length - 1 - i];
+
+    buffer[length] = '\n';
+
+    return length + 1;
+}
+
+/** @brief Dołącza wątek do zadania równoległego potoku.
+ * Wymaga blokady potoku i wolnego miejsca w zadaniu; na czas wykonywania zadania zwalnia blokadę.
+ */
+static void pipelineJobJoin(void) {
+
+    void (*job)(void *) = pipeline.job;
+    void *argument = pipeline.jobArgument;
+
+    pipeline.jobSlots--;
+    pipeline.jobActive++;
+
+    pthread_mutex_unlock(&(pipeline.lock));
+    job(argument);
+    pthread_mutex_lock(&(pipeline.lock));
+
+    pipeline.jobActive--;
+    if (pipeline.jobActive == 0)
+        pthread_cond_signal(&(pipeline.jobDone));
+}
+
+/** @brief Wykonuje zadanie równoległe na wątku wywołującym i na wolnych wątkach potoku.
+ * Funkcja wykonawcy (@ref ParallelExecutor) potoku. Do zadania dołączają wątki robocze, gdy
+ * skończą bieżące zapytania, i wątek główny, gdy czeka na wyniki, więc zadanie nie uruchamia
+ * nowych wątków ani nie zajmuje procesorów ponad te, na których działa potok. Zadania są
+ * zlecane przez zapytania @ref QUERY_COUNT, po których potok jest od razu opróżniany, więc
+ * w potoku jest naraz co najwyżej jedno zadanie.
+ * @param[in] context - nieużywany;
+ * @param[in] job - wykonywane zadanie;
+ * @param[in,out] argument - argument zadania;
+ * @param[in] threads - największa liczba wątków wykonujących zadanie, wliczając wywołujący.
+ */
+static void pipelineExecutorRun(void *context, void (*job)(void *argument), void *argument, size_t threads) {
+
+    (void) context;
+
+    pthread_mutex_lock(&(pipeline.lock));
+
+    pipeline.job = job;
+    pipeline.jobArgument = argument;
+    pipeline.jobSlots = (threads > 1 ? threads - 1 : 0);
+    pthread_cond_broadcast(&(pipeline.pending));
+    pthread_cond_signal(&(pipeline.finished));
+
+    pthread_mutex_unlock(&(pipeline.lock));
+
+    job(argument);
+
+    /* Wątki, które nie zdążyły dołączyć, nie dołączą już do zakończonego zadania. */
+    pthread_mutex_lock(&(pipeline.lock));
+
+    pipeline.jobSlots = 0;
+
+    while (pipeline.jobActive > 0)
+        pthread_cond_wait(&(pipeline.jobDone), &(pipeline.lock));
+
+    pthread_mutex_unlock(&(pipeline.lock));
+}
+
+/** @brief Wykonawca zadań równoległych działający na wątkach potoku.
+ */
+static const struct ParallelExecutor pipelineExecutor = {pipelineExecutorRun, NULL};
+
+/** @brief Wykonuje zapytanie tylko do odczytu.
+ * Zapisuje w zapytaniu tekst, który wypisałaby komenda. W razie braku pamięci oznacza zapytanie
+ * jako nieudane. Może być wywoływana współbieżnie dla różnych zapytań.
+ * @param[in,out] query - wskaźnik na zapytanie.
+ */
+static void queryRun(struct Query *query) {
+
+    if (query->failed)
+        return;
+
+    query->output = query->inlineOutput;
+
+    if (query->kind == QUERY_FORWARD) {
+
+        size_t length = phfwdGetInto(query->pf, query->num, query->output, GET_BUFFER_SIZE);
+
+        if (length >= GET_BUFFER_SIZE) {
+
+            if (!queryReserve(query, length + 1))
+                return;
+
+            phfwdGetInto(query->pf, query->num, query->output, length + 1);
+        }
+
+        query->output[length] = '\n';
+        query->length = length + 1;
+    }
+
+    else if (query->kind == QUERY_REVERSE) {
+
+        const struct PhoneNumbers* pnum = phfwdReverse(query->pf, query->num);
+        size_t length = phnumCopyLines(pnum, query->output, GET_BUFFER_SIZE);
+
+        /* Wynik mieszczący się w buforze zapytania jest już w nim zapisany. */
+        if (length > GET_BUFFER_SIZE && queryReserve(query, length))
+            phnumCopyLines(pnum, query->output, length);
+
+        query->length = length;
+        phnumDelete(pnum);
+    }
+
+    else {
+
+        size_t len = strlen(query->num);
+
+        len = (len > NUMBER_OF_DIGITS ? len - NUMBER_OF_DIGITS : 0);
+
+        size_t count = phfwdNonTrivialCountOn(query->pf, query->num, len, &pipelineExecutor, pipeline.workers + 1);
+
+        query->length = formatCount(count, query->output);
+    }
+}
+
+/** @brief Pętla wątku roboczego potoku zapytań.
+ * Pobiera kolejne zapytania z potoku i wykonuje je, aż potok zostanie zamknięty. Do zleconego
+ * zadania równoległego dołącza przed pobraniem kolejnego zapytania.
+ * @param[in] argument - nieużywany.
+ * @return Wartość NULL.
+ */
+static void *pipelineWorker(void *argument) {
+
+    (void) argument;
+
+    pthread_mutex_lock(&(pipeline.lock));
+
+    while (true) {
+
+        while (!pipeline.closing && pipeline.next == pipeline.count && pipeline.jobSlots == 0)
+            pthread_cond_wait(&(pipeline.pending), &(pipeline.lock));
+
+        if (pipeline.jobSlots > 0) {
+            pipelineJobJoin();
+            continue;
+        }
+
+        if (pipeline.next == pipeline.count)
+            break;
+
+        struct Query *query = &(pipeline.queries[pipeline.next]);
+        pipeline.next++;
+
+        pthread_mutex_unlock(&(pipeline.lock));
+        queryRun(query);
+        pthread_mutex_lock(&(pipeline.lock));
+
+        pipeline.done++;
+        if (pipeline.done == pipeline.count)
+            pthread_cond_signal(&(pipeline.finished));
+    }
+
+    pthread_mutex_unlock(&(pipeline.lock));
+
+    return NULL;
+}
+
+/** @brief Uruchamia potok zapytań.
+ * Uruchamia po jednym wątku roboczym na każdy procesor poza tym, na którym działa wątek główny.
+ * Jeśli uruchomienie wątku się nie powiedzie, potok działa z mniejszą ich liczbą; bez wątków
+ * roboczych zapytania wykonuje wątek główny.
+ */
+static void pipelineStart(void) {
+
+    pthread_mutex_init(&(pipeline.lock), NULL);
+    pthread_cond_init(&(pipeline.pending), NULL);
+    pthread_cond_init(&(pipeline.finished), NULL);
+    pthread_cond_init(&(pipeline.jobDone), NULL);
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = (processors > 1 ? (size_t) processors - 1 : 0);
+
+    if (workers > PIPELINE_MAX_WORKERS)
+        workers = PIPELINE_MAX_WORKERS;
+
+    while (pipeline.workers < workers
+           && pthread_create(&(pipeline.threads[pipeline.workers]), NULL, pipelineWorker, NULL) == 0)
+        pipeline.workers++;
+}
+
+/** @brief Kończy pracę wątków roboczych potoku zapytań.
+ * Potok nie może zawierać zapytań.
+ */
+static void pipelineStop(void) {
+
+    pthread_mutex_lock(&(pipeline.lock));
+    pipeline.closing = true;
+    pthread_cond_broadcast(&(pipeline.pending));
+    pthread_mutex_unlock(&(pipeline.lock));
+
+    for (size_t i = 0; i < pipeline.workers; i++)
+        pthread_join(pipeline.threads[i], NULL);
+
+    pipeline.workers = 0;
+
+    textChunksFree(pipeline.text);
+    pipeline.text = NULL;
+}
+
+/** @brief Wykonuje wszystkie zapytania z potoku i wypisuje ich wyniki.
+ * Wątek główny wykonuje zapytania niepobrane przez wątki robocze, czeka na pozostałe,
+ * dołączając w tym czasie do zleconych zadań równoległych, i wypisuje wyniki w kolejności komend. Jeśli któreś zapytanie się nie powiodło, wypisuje
+ * wyniki wcześniejszych zapytań i stosowny błąd, po czym kończy działanie programu.
+ * Musi być wywołana przed każdą zmianą baz przekierowań i przed zakończeniem programu.
+ * @param[in,out] pfList - wskaźnik na listę baz przekierowań.
+ */
+static void pipelineDrain(struct ForwardTreeList *pfList) {
+
+    pthread_mutex_lock(&(pipeline.lock));
+
+    while (pipeline.next < pipeline.count) {
+
+        struct Query *query = &(pipeline.queries[pipeline.next]);
+        pipeline.next++;
+
+        pthread_mutex_unlock(&(pipeline.lock));
+        queryRun(query);
+        pthread_mutex_lock(&(pipeline.lock));
+
+        pipeline.done++;
+    }
+
+    while (pipeline.done < pipeline.count) {
+
+        if (pipeline.jobSlots > 0)
+            pipelineJobJoin();
+
+        else
+            pthread_cond_wait(&(pipeline.finished), &(pipeline.lock));
+    }
+
+    size_t count = pipeline.count;
+    pipeline.count = 0;
+    pipeline.next = 0;
+    pipeline.done = 0;
+
+    pthread_mutex_unlock(&(pipeline.lock));
+
+    struct Query *failure = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+
+        struct Query *query = &(pipeline.queries[i]);
+
+        if (query->failed && failure == NULL)
+            failure = query;
+
+        if (failure == NULL)
+            outputAppend(query->output, query->length);
+
+        if (query->output != query->inlineOutput)
+            free(query->output);
+    }
+
+    if (pipeline.text != NULL) {
+
+        textChunksFree(pipeline.text->next);
+        pipeline.text->next = NULL;
+        pipeline.text->used = 0;
+    }
+
+    if (failure != NULL) {
+
+        fprintf(stderr, "ERROR %c %d\n", (failure->kind == QUERY_COUNT ? '@' : '?'), failure->byteNumber);
+        delFwdTreeList(pfList);
+        exit(1);
+    }
+}
+
+/** @brief Odkłada zapytanie do potoku.
+ * Kopiuje numer do pamięci potoku. Jeśli potok jest pełny, najpierw wypisuje wyniki
+ * czekających zapytań. Jeśli nie udało się skopiować numeru, zapytanie jest od razu nieudane.
+ * @param[in,out] pfList - wskaźnik na listę baz przekierowań;
+ * @param[in] kind - rodzaj zapytania;
+ * @param[in] pf - wskaźnik na bazę, której dotyczy zapytanie;
+ * @param[in] num - numer będący argumentem zapytania;
+ * @param[in] byteNumber - numer pierwszego znaku operatora.
+ */
+static void pipelineSubmit(struct ForwardTreeList *pfList, enum QueryKind kind, struct PhoneForward *pf, struct Token num, int byteNumber) {
+
+    if (pipeline.count == PIPELINE_BATCH)
+        pipelineDrain(pfList);
+
+    const char *text = pipelineText(num);
+
+    pthread_mutex_lock(&(pipeline.lock));
+
+    struct Query *query = &(pipeline.queries[pipeline.count]);
+    query->kind = kind;
+    query->pf = pf;
+    query->num = text;
+    query->byteNumber = byteNumber;
+    query->output = NULL;
+    query->length = 0;
+    query->failed = (text == NULL);
+
+    pipeline.count++;
+    pthread_cond_signal(&(pipeline.pending));
+
+    pthread_mutex_unlock(&(pipeline.lock));
+}
+
 /** @brief Dodaję bazę do listy baz przekierowań.
  * Dodaje bazę o podanym identyfikatorze do listy baz przekierowań. Jeśli baza o takim identyfikatorze już istnieje
  * ustawia ją jako aktualną bazę.
@@ -176,18 +983,19 @@ static bool delFromForwardTreeList(struct ForwardTreeList **pfList, const char *
  * tylko ustawia ją jako aktualną.  W przypadku błędu wykonania komendy wypisuję
  * stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] id - wskaźnik na identyfikator;
+ * @param[in] id - wskaźnik na identyfikator lub NULL, jeśli nie udało się go skopiować;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - adres wskaźnika na aktualną bazę.
  */
 static void addForwardBase(struct ForwardTreeList **pfList, const char *id, int byteNumber, struct ForwardTreeList **currentFwdTree) {
 
-    bool result = addToForwardTreeList(pfList, id, currentFwdTree);
+    pipelineDrain((*pfList));
+
+    bool result = (id != NULL && addToForwardTreeList(pfList, id, currentFwdTree));
 
     if (result == false) {
 
         fprintf(stderr, "ERROR NEW %d\n", byteNumber);
-        free((void *) id);
         delFwdTreeList((*pfList));
         exit(1);
     }
@@ -197,18 +1005,19 @@ static void addForwardBase(struct ForwardTreeList **pfList, const char *id, int
  * Usuwa bazę przekierowań o podanym identyfikatorze. W przypadku błędu wykonania komendy wypisuję
  * stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] id - wskaźnik na identyfikator;
+ * @param[in] id - wskaźnik na identyfikator lub NULL, jeśli nie udało się go skopiować;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - adres wskaźnika na aktualną bazę.
  */
 static void delForwardBase(struct ForwardTreeList **pfList, const char *id, int byteNumber, struct ForwardTreeList **currentFwdTree) {
 
-    bool result = delFromForwardTreeList(pfList, id, currentFwdTree);
+    pipelineDrain((*pfList));
+
+    bool result = (id != NULL && delFromForwardTreeList(pfList, id, currentFwdTree));
 
     if (result == false) {
 
         fprintf(stderr, "ERROR DEL %d\n", byteNumber);
-        free((void *) id);
         delFwdTreeList((*pfList));
         exit(1);
     }
@@ -218,29 +1027,30 @@ static void delForwardBase(struct ForwardTreeList **pfList, const char *id, int
  * Dodaje dane dane przekierowanie do drzewa przekierowań aktualnej bazy.
  * W przypadku błędu wykonania komendy wypisuję stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] from - wskaźnik na numer, z którego jest przekierowanie;
- * @param[in,out] to - wskaźnik na numer na który jest przekierowanie;
+ * @param[in] from - wskaźnik na numer, z którego jest przekierowanie, lub NULL, jeśli nie udało się go skopiować;
+ * @param[in] to - wskaźnik na numer na który jest przekierowanie lub NULL, jeśli nie udało się go skopiować;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - wskaźnik na aktualną bazę.
  */
 static void addForward(struct ForwardTreeList **pfList, const char *from, const char *to, int byteNumber, struct ForwardTreeList *currentFwdTree) {
 
-    if (currentFwdTree == NULL) {
+    pipelineDrain((*pfList));
+
+    if (currentFwdTree == NULL || from == NULL || to == NULL) {
 
         fprintf(stderr, "ERROR > %d\n", byteNumber);
-        free((void *) from);
-        free((void *) to);
         delFwdTreeList((*pfList));
         exit(1);
     }
 
     bool result = phfwdAdd(currentFwdTree->pf, from, to);
 
+    if (result == true && currentFwdTree->journal != NULL)
+        result = journalAdd(currentFwdTree->journal, currentFwdTree->pf, from, to);
+
     if (result == false) {
 
         fprintf(stderr, "ERROR > %d\n", byteNumber);
-        free((void *) from);
-        free((void *) to);
         delFwdTreeList((*pfList));
         exit(1);
     }
@@ -250,105 +1060,94 @@ static void addForward(struct ForwardTreeList **pfList, const char *from, const
  * Usuwa z aktualnej bazy przekierowania o podanym prefiksie.
  * W przypadku błędu wykonania komendy wypisuję stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] num - wskaźnik na numer będącym prefiksem z jakim przekierowania mają zostać usunięte;
+ * @param[in] num - wskaźnik na numer będącym prefiksem z jakim przekierowania mają zostać usunięte
+ *                  lub NULL, jeśli nie udało się go skopiować;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - wskaźnik na aktualną bazę.
  */
 static void removeForwards(struct ForwardTreeList **pfList, const char *num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
 
-    if (currentFwdTree == NULL) {
+    pipelineDrain((*pfList));
+
+    if (currentFwdTree == NULL || num == NULL) {
 
         fprintf(stderr, "ERROR DEL %d\n", byteNumber);
-        free((void *) num);
         delFwdTreeList((*pfList));
         exit(1);
     }
 
     phfwdRemove(currentFwdTree->pf, num);
+
+    if (currentFwdTree->journal != NULL && !journalRemove(currentFwdTree->journal, currentFwdTree->pf, num)) {
+
+        fprintf(stderr, "ERROR DEL %d\n", byteNumber);
+        delFwdTreeList((*pfList));
+        exit(1);
+    }
 }
 
 /** @brief Wykonuje komendę wypisania przekierowania z danego numeru.
- * Wypisuje przekierowanie podanego numeru w aktualnej bazie.
+ * Odkłada do potoku zapytań wyznaczenie przekierowania podanego numeru w aktualnej bazie.
  * W przypadku błędu wykonania komendy wypisuję stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] num - wskaźnik na numer;
+ * @param[in] num - numer;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - wskaźnik na aktualną bazę.
  */
-static void getForward(struct ForwardTreeList **pfList, const char *num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
+static void getForward(struct ForwardTreeList **pfList, struct Token num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
 
     if (currentFwdTree == NULL) {
 
+        pipelineDrain((*pfList));
         fprintf(stderr, "ERROR ? %d\n", byteNumber);
-        free((void *) num);
         delFwdTreeList((*pfList));
         exit(1);
     }
 
-    const struct PhoneNumbers* pnum = phfwdGet(currentFwdTree->pf, num);
-
-    printf("%s\n", phnumGet(pnum, 0));
-    phnumDelete(pnum);
+    pipelineSubmit((*pfList), QUERY_FORWARD, currentFwdTree->pf, num, byteNumber);
 }
 
 /** @brief Wykonuje komendę wypisania przekierowań na dany numer.
- * Wypisuję numery, które przekierowują się na dany numer w aktualnej bazie.
+ * Odkłada do potoku zapytań wyznaczenie numerów, które przekierowują się na dany numer w aktualnej bazie.
  * W przypadku błędu wykonania komendy wypisuję stosowny błąd i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] num - wskaźnik na numer;
+ * @param[in] num - numer;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - wskaźnik na aktualną bazę.
  */
-static void getReverse(struct ForwardTreeList **pfList, const char *num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
+static void getReverse(struct ForwardTreeList **pfList, struct Token num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
 
     if (currentFwdTree == NULL) {
 
+        pipelineDrain((*pfList));
         fprintf(stderr, "ERROR ? %d\n", byteNumber);
-        free((void *) num);
         delFwdTreeList((*pfList));
         exit(1);
     }
 
-    const struct PhoneNumbers* pnum = phfwdReverse(currentFwdTree->pf, num);
-
-    size_t index = 0;
-    const char *number = phnumGet(pnum, index);
-
-    while (number != NULL) {
-
-        printf("%s\n", phnumGet(pnum, index));
-        index++;
-        number = phnumGet(pnum, index);
-    }
-
-    phnumDelete(pnum);
+    pipelineSubmit((*pfList), QUERY_REVERSE, currentFwdTree->pf, num, byteNumber);
 }
 
 /** @brief Wykonuję komendę zliczania nietrywialnych numerów.
- * Wypisuję rezultat wywołania funkcji @ref phfwdNonTrivialCount na aktualnej bazie przekierowań.
- * W razie błędu wykonania wypisuję stosowny komunikat i kończy działanie programu.
+ * Odkłada do potoku zapytań wywołanie funkcji @ref phfwdNonTrivialCount na aktualnej bazie przekierowań
+ * i od razu wypisuje wyniki potoku, bo zliczania nie mogą działać współbieżnie ze sobą. W razie błędu wykonania wypisuję stosowny komunikat i kończy działanie programu.
  * @param[in,out] pfList - adres wskaźnika na listę baz przekierowań;
- * @param[in,out] num - wskaźnik na numer;
+ * @param[in] num - numer;
  * @param[in] byteNumber - numer pierwszego znaku wywołanego operatora;
  * @param[in,out] currentFwdTree - wskaźnik na aktualną bazę.
  */
-static void getNonTrivialCount(struct ForwardTreeList **pfList, const char *num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
+static void getNonTrivialCount(struct ForwardTreeList **pfList, struct Token num, int byteNumber, struct ForwardTreeList *currentFwdTree) {
 
     if (currentFwdTree == NULL) {
 
+        pipelineDrain((*pfList));
         fprintf(stderr, "ERROR @ %d\n", byteNumber);
-        free((void *) num);
         delFwdTreeList((*pfList));
         exit(1);
     }
 
-    size_t len = strlen(num);
-
-    len = (len > NUMBER_OF_DIGITS ? len - NUMBER_OF_DIGITS : 0);
-
-    size_t solution = phfwdNonTrivialCount(currentFwdTree->pf, num, len);
-
-    printf("%zu\n", solution);
+    pipelineSubmit((*pfList), QUERY_COUNT, currentFwdTree->pf, num, byteNumber);
+    pipelineDrain((*pfList));
 }
 
 /** @brief Sprawdza czy znak jest białym znakiem
@@ -381,6 +1180,7 @@ static bool isDigit(char ch) {
  */
 static void errorInputOrEof(struct ForwardTreeList *pfList, char ch, int byteNumber) {
 
+    pipelineDrain(pfList);
     delFwdTreeList(pfList);
     if (ch == EOF)
         fprintf(stderr, "ERROR EOF\n");
@@ -401,26 +1201,26 @@ static void errorInputOrEof(struct ForwardTreeList *pfList, char ch, int byteNum
 static int loadComment(int *byteNumber) {
 
     bool endOfComment = false;
-    char ch = getchar();
+    char ch = inputGet();
     (*byteNumber)++;
 
     if (ch != '$') {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
         return ERROR;
     }
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     while (!endOfComment) {
 
         while (ch != '$' && ch != EOF) {
-            ch = getchar();
+            ch = inputGet();
             (*byteNumber)++;
         }
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
 
         if (ch == EOF)
@@ -444,12 +1244,12 @@ static int loadComment(int *byteNumber) {
 static int loadWhiteSpacesAndComments(int *byteNumber) {
 
     int result;
-    char ch = getchar();
+    char ch = inputGet();
     bool end = false;
 
     if (ch != '$' && !isWhiteSgn(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         return NOTHING_LOADED;
     }
 
@@ -458,7 +1258,7 @@ static int loadWhiteSpacesAndComments(int *byteNumber) {
     while (!end) {
 
         while (isWhiteSgn(ch)) {
-            ch = getchar();
+            ch = inputGet();
             (*byteNumber)++;
         }
 
@@ -468,13 +1268,13 @@ static int loadWhiteSpacesAndComments(int *byteNumber) {
             if (result != SUCCESS)
                 return result;
 
-            ch = getchar();
+            ch = inputGet();
             (*byteNumber)++;
         }
 
         if (!isWhiteSgn(ch) && ch != '$') {
             end = true;
-            ungetc(ch, stdin);
+            inputUnget(ch);
             (*byteNumber)--;
         }
     }
@@ -482,104 +1282,75 @@ static int loadWhiteSpacesAndComments(int *byteNumber) {
     return SUCCESSFULLY_LOADED;
 }
 
-/** @brief Wczytuję liczbę.
- * Wczytuję liczbę do tablicy znaków.
- * Przy wywołaniu funkcji pierwszy wczytany znak jest cyfrą.
- * @param[in,out] byteNumber - wskaźnik na licznik wczytanych znaków;
- * @return Wskaźnik na wczytaną liczbę.
+/** @brief Sprawdza czy znak może należeć do identyfikatora.
+ * @param[in] ch - sprawdzany znak.
+ * @return Wartość @p true jeśli znak jest literą lub cyfrą,
+ *         wartość @p false w przeciwnym razie.
  */
-static const char *loadNumber(int *byteNumber) {
+static bool isIdSgn(char ch) {
 
-    char *num = malloc(sizeof(char) * STARTING_SIZE);
+    return (isalnum(ch) != 0);
+}
 
-    if (num == NULL)
-        return num;
+/** @brief Wczytuję token.
+ * Wczytuję najdłuższy ciąg znaków spełniających warunek, zaczynając od bieżącej pozycji wejścia.
+ * Token nie jest kopiowany, zapamiętywana jest tylko jego pozycja na wejściu, a bufor wejścia
+ * przechowuje go do końca bieżącej komendy.
+ * @param[in,out] byteNumber - wskaźnik na licznik wczytanych znaków;
+ * @param[in] accepts - funkcja sprawdzająca, czy znak należy do tokenu;
+ * @param[out] token - wskaźnik na miejsce na wczytany token.
+ * @return Wartość @p true jeśli token został wczytany,
+ *         wartość @p false, gdy wystąpił problem z alokacją pamięci.
+ */
+static bool loadToken(int *byteNumber, bool (*accepts)(char), struct Token *token) {
 
-    char *extended;
-    size_t size = STARTING_SIZE;
-    size_t i = 0;
-    char ch = getchar();
-    (*byteNumber)++;
+    size_t start = input.base + input.position;
 
-    while (isDigit(ch)) {
+    if (!input.pinning) {
+        input.pinning = true;
+        input.pinned = start;
+    }
 
-        if ((i + 1) == size) {
+    do {
 
-            extended = realloc(num, (MULTIPLIER * size) / DIVISOR);
-            size = (MULTIPLIER * size) / DIVISOR;
+        while (input.position < input.size && accepts(input.data[input.position]))
+            input.position++;
 
-            if (extended == NULL) {
-                ungetc(ch, stdin);
-                free(num);
-                return extended;
-            }
+    } while (input.position == input.size && inputFill());
 
-            else
-                num = extended;
-        }
+    token->offset = start;
+    token->length = input.base + input.position - start;
+    (*byteNumber) += (int) token->length;
 
-        num[i] = ch;
-        i++;
-        ch = getchar();
-        (*byteNumber)++;
-    }
+    /* Znak za tokenem jest wczytywany i cofany tak jak w pozostałych funkcjach wczytujących,
+     * więc znak równy EOF zostaje pominięty tak samo jak przez nie. */
+    inputUnget((char) inputGet());
 
-    num[i] = '\0';
+    return !input.failed;
+}
 
-    ungetc(ch, stdin);
-    (*byteNumber)--;
+/** @brief Wczytuję liczbę.
+ * Przy wywołaniu funkcji pierwszy wczytany znak jest cyfrą.
+ * @param[in,out] byteNumber - wskaźnik na licznik wczytanych znaków;
+ * @param[out] num - wskaźnik na miejsce na wczytaną liczbę.
+ * @return Wartość @p true jeśli liczba została wczytana,
+ *         wartość @p false, gdy wystąpił problem z alokacją pamięci.
+ */
+static bool loadNumber(int *byteNumber, struct Token *num) {
 
-    return num;
+    return loadToken(byteNumber, isDigit, num);
 }
 
 /** @brief Wczytuję identyfikator.
- * Wczytuję identyfikator do tablicy znaków.
  * Przy wywołaniu funkcji pierwszy wczytany znak jest literą.
  * @param[in,out] byteNumber - wskaźnik na licznik wczytanych znaków;
- * @return Wskaźnik na wczytany identyfikator.
+ * @param[out] id - wskaźnik na miejsce na wczytany identyfikator.
+ * @return Wartość @p true jeśli identyfikator został wczytany,
+ *         wartość @p false, gdy wystąpił problem z alokacją pamięci.
  */
-static const char *loadId(int *byteNumber) {
-
-    char *id = malloc(sizeof(char) * STARTING_SIZE);
-
-    if (id == NULL)
-        return id;
-
-    char *extended;
-    size_t size = STARTING_SIZE;
-    size_t i = 0;
-    char ch = getchar();
-    (*byteNumber)++;
+static bool loadId(int *byteNumber, struct Token *id) {
 
-    while (isalnum(ch)) {
-
-        if ((i + 1) == size) {
-
-            extended = realloc(id, MULTIPLIER * size / DIVISOR);
-            size = (MULTIPLIER * size) / DIVISOR;
-
-            if (extended == NULL) {
-                ungetc(ch, stdin);
-                free(id);
-                return extended;
-            }
-
-            else
-                id = extended;
-        }
-
-        id[i] = ch;
-        i++;
-        ch = getchar();
-        (*byteNumber)++;
-    }
-
-    id[i] = '\0';
-
-    ungetc(ch, stdin);
-    (*byteNumber)--;
-
-    return id;
+    return loadToken(byteNumber, isIdSgn, id);
 }
 
 /** @brief Wczytuję dalszą część komendy dodawania bazy i wykonuję ją.
@@ -592,13 +1363,13 @@ static const char *loadId(int *byteNumber) {
  */
 static void tryNewCommand(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree) {
 
-    char ch = getchar();
+    char ch = inputGet();
     (*byteNumber)++;
 
     if (ch != 'E')
         errorInputOrEof((*pfList), ch, (*byteNumber));
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (ch != 'W')
@@ -607,39 +1378,36 @@ static void tryNewCommand(struct ForwardTreeList **pfList, int *byteNumber, int
     int result = loadWhiteSpacesAndComments(byteNumber);
     if (result == NOTHING_LOADED || result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if(!isalpha(ch))
         errorInputOrEof((*pfList), ch, (*byteNumber));
 
-    ungetc(ch, stdin);
+    inputUnget(ch);
     (*byteNumber)--;
 
-    const char* id = loadId(byteNumber);
+    struct Token id;
 
-    if (id == NULL) {
-        ch = getchar();
+    if (!loadId(byteNumber, &id)) {
+        ch = inputGet();
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    if (strcmp(id, "DEL") == 0 || strcmp(id, "NEW") == 0) {
+    if (tokenEquals(id, "DEL") || tokenEquals(id, "NEW")) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
 
-        free((void *) id);
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    addForwardBase(pfList, id, startingByte, currentFwdTree);
-
-    free((void *) id);
+    addForwardBase(pfList, tokenString(id, 0), startingByte, currentFwdTree);
 }
 
 /** @brief Wczytuję dalszą część komendy usuwania bazy przekierowań i wykonuję ją.
@@ -653,24 +1421,22 @@ static void tryNewCommand(struct ForwardTreeList **pfList, int *byteNumber, int
 static void tryDelBaseCommand(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree) {
 
     char ch;
-    const char *id = loadId(byteNumber);
+    struct Token id;
 
-    if (id == NULL) {
-        ch = getchar();
+    if (!loadId(byteNumber, &id)) {
+        ch = inputGet();
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    if (strcmp(id, "DEL") == 0 || strcmp(id, "NEW") == 0) {
+    if (tokenEquals(id, "DEL") || tokenEquals(id, "NEW")) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
 
-        free((void *) id);
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    delForwardBase(pfList, id, startingByte, currentFwdTree);
-    free((void *) id);
+    delForwardBase(pfList, tokenString(id, 0), startingByte, currentFwdTree);
 }
 
 /** @brief Wczytuję dalszą część komendy usuwania przekierowań i wykonuję ją.
@@ -684,16 +1450,15 @@ static void tryDelBaseCommand(struct ForwardTreeList **pfList, int *byteNumber,
 static void tryDelForwardCommand(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree) {
 
     char ch;
-    const char* num = loadNumber(byteNumber);
+    struct Token num;
 
-    if (num == NULL) {
+    if (!loadNumber(byteNumber, &num)) {
 
-        ch = getchar();
+        ch = inputGet();
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    removeForwards(pfList, num, startingByte, (*currentFwdTree));
-    free((void *) num);
+    removeForwards(pfList, tokenString(num, 0), startingByte, (*currentFwdTree));
 }
 
 /** @brief Wczytuję dalszą część komendy usunięcia przekierowań lub bazy i wykonuję ją.
@@ -707,13 +1472,13 @@ static void tryDelForwardCommand(struct ForwardTreeList **pfList, int *byteNumbe
  */
 static void tryDelCommand(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree) {
 
-    char ch = getchar();
+    char ch = inputGet();
     (*byteNumber)++;
 
     if (ch != 'E')
         errorInputOrEof((*pfList), ch, (*byteNumber));
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (ch != 'L')
@@ -722,17 +1487,17 @@ static void tryDelCommand(struct ForwardTreeList **pfList, int *byteNumber, int
     int result = loadWhiteSpacesAndComments(byteNumber);
     if (result == NOTHING_LOADED || result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (isDigit(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
 
         tryDelForwardCommand(pfList, byteNumber, startingByte, currentFwdTree);
@@ -740,7 +1505,7 @@ static void tryDelCommand(struct ForwardTreeList **pfList, int *byteNumber, int
 
     else if (isalpha(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
 
         tryDelBaseCommand(pfList, byteNumber, startingByte, currentFwdTree);
@@ -765,29 +1530,27 @@ static void tryReverse(struct ForwardTreeList **pfList, int *byteNumber, int sta
     int result = loadWhiteSpacesAndComments(byteNumber);
     if (result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (isDigit(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
 
-        const char* num = loadNumber(byteNumber);
+        struct Token num;
 
-        if (num == NULL) {
-            ch = getchar();
+        if (!loadNumber(byteNumber, &num)) {
+            ch = inputGet();
             errorInputOrEof((*pfList), ch, (*byteNumber));
         }
 
         getReverse(pfList, num, startingByte, (*currentFwdTree));
-
-        free((void *) num);
     }
 
     else
@@ -802,9 +1565,9 @@ static void tryReverse(struct ForwardTreeList **pfList, int *byteNumber, int sta
  * @param[in,out] byteNumber - wskaźnik na licznik wczytanych znaków;
  * @param[in] startingByte - numer pierwszego znaku wczytanego operatora;
  * @param[in,out] currentFwdTree - adres wskaźnika na aktualną bazę przekierowań;
- * @param[in] num1 - wskaźnik na numer, z którego jest przekierowanie.
+ * @param[in] num1 - numer, z którego jest przekierowanie.
  */
-static void tryAddForward(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree, const char *num1) {
+static void tryAddForward(struct ForwardTreeList **pfList, int *byteNumber, int startingByte, struct ForwardTreeList **currentFwdTree, struct Token num1) {
 
     char ch;
     int result;
@@ -812,37 +1575,31 @@ static void tryAddForward(struct ForwardTreeList **pfList, int *byteNumber, int
     result = loadWhiteSpacesAndComments(byteNumber);
     if (result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
-        free((void *) num1);
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (isDigit(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
 
-        const char* num2 = loadNumber(byteNumber);
+        struct Token num2;
 
-        if (num2 == NULL) {
-            ch = getchar();
+        if (!loadNumber(byteNumber, &num2)) {
+            ch = inputGet();
             errorInputOrEof((*pfList), ch, (*byteNumber));
         }
 
-        addForward(pfList, num1, num2, startingByte, (*currentFwdTree));
-        free((void *) num1);
-        free((void *) num2);
+        addForward(pfList, tokenString(num1, 0), tokenString(num2, 1), startingByte, (*currentFwdTree));
     }
 
-    else {
-
-        free((void *) num1);
+    else
         errorInputOrEof((*pfList), ch, (*byteNumber));
-    }
 }
 
 /** @brief Wczytuję dalszą część komendy wypisania lub dodania przekierowania i wykonuję ją.
@@ -858,23 +1615,22 @@ static void tryGetOrAddForward(struct ForwardTreeList **pfList, int *byteNumber,
     char ch;
     int result;
     int startingByte;
-    const char *num1 = loadNumber(byteNumber);
+    struct Token num1;
 
-    if (num1 == NULL) {
-        ch = getchar();
+    if (!loadNumber(byteNumber, &num1)) {
+        ch = inputGet();
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
     result = loadWhiteSpacesAndComments(byteNumber);
     if (result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
-        free((void *) num1);
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     switch (ch) {
@@ -883,7 +1639,6 @@ static void tryGetOrAddForward(struct ForwardTreeList **pfList, int *byteNumber,
 
             startingByte = (*byteNumber);
             getForward(pfList, num1, startingByte, (*currentFwdTree));
-            free((void *) num1);
             break;
 
         case '>':
@@ -894,7 +1649,6 @@ static void tryGetOrAddForward(struct ForwardTreeList **pfList, int *byteNumber,
 
         default:
 
-            free((void *) num1);
             errorInputOrEof((*pfList), ch, (*byteNumber));
             break;
     }
@@ -915,29 +1669,27 @@ void tryCountNonTrivialCommand(struct ForwardTreeList **pfList, int *byteNumber,
     int result = loadWhiteSpacesAndComments(byteNumber);
     if (result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     if (isDigit(ch)) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         (*byteNumber)--;
 
-        const char* num = loadNumber(byteNumber);
+        struct Token num;
 
-        if (num == NULL) {
-            ch = getchar();
+        if (!loadNumber(byteNumber, &num)) {
+            ch = inputGet();
             errorInputOrEof((*pfList), ch, (*byteNumber));
         }
 
         getNonTrivialCount(pfList, num, startingByte, (*currentFwdTree));
-
-        free((void *) num);
     }
 
     else
@@ -955,16 +1707,18 @@ static void loadAndExecuteCommand(struct ForwardTreeList **pfList, int *byteNumb
 
     char ch;
 
+    inputUnpin();
+
     int result = loadWhiteSpacesAndComments(byteNumber);
 
     if (result == ERROR) {
 
-        ch = getchar();
+        ch = inputGet();
         (*byteNumber)++;
         errorInputOrEof((*pfList), ch, (*byteNumber));
     }
 
-    ch = getchar();
+    ch = inputGet();
     (*byteNumber)++;
 
     switch (ch) {
@@ -988,7 +1742,7 @@ static void loadAndExecuteCommand(struct ForwardTreeList **pfList, int *byteNumb
         default:
             if (isDigit(ch)) {
 
-                ungetc(ch, stdin);
+                inputUnget(ch);
                 (*byteNumber)--;
                 tryGetOrAddForward(pfList, byteNumber, currentFwdTree);
             }
@@ -1001,31 +1755,45 @@ static void loadAndExecuteCommand(struct ForwardTreeList **pfList, int *byteNumb
 /** @brief Wczytuję pojedynczo wszystkie komendy z wejścia i je wykonuje.
  * Funkcja wczytuję wszystkie komendy z wejścia i po kolei je wykonuję.
  * W przypadku jakichkolwiek błędów składniowych, bądź wykonania kończy działanie programu i wypisuje stosowny błąd.
+ * Opcjonalny argument to katalog, w którym zapisywane są dzienniki zmian baz; bazy
+ * są z nich odtwarzane komendą NEW, a usuwane wraz z bazą komendą DEL.
+ * @param[in] argc - liczba argumentów programu;
+ * @param[in] argv - tablica argumentów programu.
  * @return Wartość 0 w przypadku gdy nie wystąpił, żaden błąd,
  *         a wartość 1, gdy wystąpił błąd składniowy, bądź wykonania.
  */
-int main() {
+int main(int argc, char *argv[]) {
 
     int byteNumber = 0;
 
+    if (argc > 1)
+        journalDirectory = argv[1];
+
     struct ForwardTreeList *pfList = NULL;
 
     struct ForwardTreeList *currentBase = NULL;
 
-    char ch = getchar();
+    atexit(outputFlush);
+    pipelineStart();
+    inputOpen();
+
+    char ch = inputGet();
     byteNumber++;
 
     while (ch != EOF) {
 
-        ungetc(ch, stdin);
+        inputUnget(ch);
         byteNumber--;
 
         loadAndExecuteCommand(&(pfList), &byteNumber, &currentBase);
 
-        ch = getchar();
+        ch = inputGet();
         byteNumber++;
     }
 
+    pipelineDrain(pfList);
+    pipelineStop();
+    inputClose();
     delFwdTreeList(pfList);
 
     return 0;
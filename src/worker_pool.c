@@ -0,0 +1,138 @@
+/** @file
+ * Implementacja puli wątków wykonujących zadania równoległe
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#include <stdlib.h>
+#include "worker_pool.h"
+
+/** @brief Pętla wątku puli.
+ * Czeka na zadanie, do którego może dołączyć, i wykonuje je, aż pula zacznie się zamykać.
+ * @param[in,out] argument - wskaźnik na pulę.
+ * @return Wartość NULL.
+ */
+static void *workerPoolThread(void *argument) {
+
+    struct WorkerPool *pool = argument;
+
+    pthread_mutex_lock(&(pool->lock));
+
+    while (true) {
+
+        while (!pool->closing && pool->slots == 0)
+            pthread_cond_wait(&(pool->wake), &(pool->lock));
+
+        if (pool->closing)
+            break;
+
+        void (*job)(void *) = pool->job;
+        void *jobArgument = pool->argument;
+
+        pool->slots--;
+        pool->active++;
+
+        pthread_mutex_unlock(&(pool->lock));
+        job(jobArgument);
+        pthread_mutex_lock(&(pool->lock));
+
+        pool->active--;
+        if (pool->active == 0)
+            pthread_cond_signal(&(pool->idle));
+    }
+
+    pthread_mutex_unlock(&(pool->lock));
+
+    return NULL;
+}
+
+/** @brief Uruchamia brakujące wątki puli.
+ * Wymaga blokady puli. Zatrzymuje się na pierwszym wątku, którego nie udało się uruchomić.
+ * @param[in,out] pool - wskaźnik na pulę;
+ * @param[in] count - wymagana liczba wątków.
+ */
+static void workerPoolGrow(struct WorkerPool *pool, size_t count) {
+
+    if (pool->threadCount >= count)
+        return;
+
+    pthread_t *threads = realloc(pool->threads, sizeof(pthread_t) * count);
+
+    if (threads == NULL)
+        return;
+
+    pool->threads = threads;
+
+    while (pool->threadCount < count
+           && pthread_create(&(pool->threads[pool->threadCount]), NULL, workerPoolThread, pool) == 0)
+        pool->threadCount++;
+}
+
+void workerPoolInit(struct WorkerPool *pool) {
+
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->wake), NULL);
+    pthread_cond_init(&(pool->idle), NULL);
+    pool->job = NULL;
+    pool->argument = NULL;
+    pool->slots = 0;
+    pool->active = 0;
+    pool->closing = false;
+    pool->threads = NULL;
+    pool->threadCount = 0;
+}
+
+void workerPoolDestroy(struct WorkerPool *pool) {
+
+    pthread_mutex_lock(&(pool->lock));
+    pool->closing = true;
+    pthread_cond_broadcast(&(pool->wake));
+    pthread_mutex_unlock(&(pool->lock));
+
+    for (size_t i = 0; i < pool->threadCount; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    free(pool->threads);
+    pthread_cond_destroy(&(pool->idle));
+    pthread_cond_destroy(&(pool->wake));
+    pthread_mutex_destroy(&(pool->lock));
+}
+
+void workerPoolRun(void *pool, void (*job)(void *argument), void *argument, size_t threads) {
+
+    struct WorkerPool *self = pool;
+
+    if (threads > 1) {
+
+        pthread_mutex_lock(&(self->lock));
+
+        workerPoolGrow(self, threads - 1);
+
+        self->job = job;
+        self->argument = argument;
+        self->slots = (self->threadCount < threads - 1 ? self->threadCount : threads - 1);
+        pthread_cond_broadcast(&(self->wake));
+
+        pthread_mutex_unlock(&(self->lock));
+    }
+
+    job(argument);
+
+    if (threads > 1) {
+
+        /* Wątki, które nie zdążyły dołączyć, nie dołączą już do zakończonego zadania. */
+        pthread_mutex_lock(&(self->lock));
+
+        self->slots = 0;
+
+        while (self->active > 0)
+            pthread_cond_wait(&(self->idle), &(self->lock));
+
+        self->job = NULL;
+        self->argument = NULL;
+
+        pthread_mutex_unlock(&(self->lock));
+    }
+}
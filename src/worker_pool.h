@@ -0,0 +1,76 @@
+/** @file
+ * Interfejs puli wątków wykonujących zadania równoległe
+ *
+ * @author Aleksander Płocharski <ap394689@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 16.10.2026
+ */
+
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Wykonawca zadań równoległych.
+ * Zadanie jest funkcją wywoływaną jednocześnie na kilku wątkach z tym samym argumentem;
+ * każde wywołanie samo bierze sobie część pracy, więc zadanie musi być poprawnie wykonane
+ * niezależnie od tego, na ilu wątkach zostało wywołane.
+ */
+struct ParallelExecutor {
+
+    /** @brief Wykonuje zadanie na wątku wywołującym i na co najwyżej @p threads - 1 innych wątkach.
+     * Wraca dopiero po zakończeniu wszystkich wywołań zadania.
+     * Wykonawca nie musi pozwalać na współbieżne zlecanie zadań.
+     * @param[in,out] context - dane wykonawcy (@p context);
+     * @param[in] job - wykonywane zadanie;
+     * @param[in,out] argument - argument zadania;
+     * @param[in] threads - największa liczba wątków wykonujących zadanie, wliczając wywołujący.
+     */
+    void (*run)(void *context, void (*job)(void *argument), void *argument, size_t threads);
+    void *context; /**< dane wykonawcy przekazywane do @p run */
+};
+
+/** @brief Pula wątków wykonujących zadania równoległe.
+ * Wątki są uruchamiane przy pierwszym zadaniu, które ich potrzebuje, i czekają na kolejne
+ * zadania aż do zniszczenia puli, więc kolejne zadania nie uruchamiają nowych wątków.
+ * Pula wykonuje naraz jedno zadanie.
+ */
+struct WorkerPool {
+
+    pthread_mutex_t lock; /**< blokada chroniąca stan puli */
+    pthread_cond_t wake; /**< sygnalizuje wątkom puli nowe zadanie lub zamykanie puli */
+    pthread_cond_t idle; /**< sygnalizuje zakończenie ostatniego wywołania zadania przez wątek puli */
+    void (*job)(void *argument); /**< wykonywane zadanie */
+    void *argument; /**< argument wykonywanego zadania */
+    size_t slots; /**< liczba wątków puli, które mogą jeszcze dołączyć do zadania */
+    size_t active; /**< liczba wątków puli wykonujących zadanie */
+    bool closing; /**< czy wątki puli mają się zakończyć */
+    pthread_t *threads; /**< tablica uruchomionych wątków */
+    size_t threadCount; /**< liczba uruchomionych wątków */
+};
+
+/** @brief Inicjuje pulę bez wątków.
+ * @param[out] pool - wskaźnik na inicjowaną pulę.
+ */
+void workerPoolInit(struct WorkerPool *pool);
+
+/** @brief Kończy pracę wątków puli i zwalnia jej zasoby.
+ * Pula nie może w tym czasie wykonywać zadania.
+ * @param[in,out] pool - wskaźnik na pulę.
+ */
+void workerPoolDestroy(struct WorkerPool *pool);
+
+/** @brief Wykonuje zadanie na wątku wywołującym i na wątkach puli.
+ * Funkcja wykonawcy (@ref ParallelExecutor) puli. Jeśli pula ma mniej niż @p threads - 1
+ * wątków, uruchamia brakujące; jeśli uruchomienie wątku się nie powiedzie, zadanie jest
+ * wykonywane na mniejszej liczbie wątków.
+ * @param[in,out] pool - wskaźnik na pulę (@ref WorkerPool);
+ * @param[in] job - wykonywane zadanie;
+ * @param[in,out] argument - argument zadania;
+ * @param[in] threads - największa liczba wątków wykonujących zadanie, wliczając wywołujący.
+ */
+void workerPoolRun(void *pool, void (*job)(void *argument), void *argument, size_t threads);
+
+#endif /* __WORKER_POOL_H__ */